@@ -0,0 +1,440 @@
+/*
+ * About : Microbenchmarks for turning screen dumps into pictures.
+ *
+ * Usage : scopebench [-n ITERATIONS] [in.svr]
+ *
+ *         Times every way we have of turning a screen dump into RGB, and of
+ *         scaling a frame to common window sizes, over synthetic frames and
+ *         the frames of a recording if one is given. Prints the time per
+ *         frame, its spread, and input bytes per TSC cycle where there is a
+ *         TSC. "make bench" builds and runs it.
+ *
+ * Notes :
+ *
+ * The kernels are in kernels.c. Each one's output is compared with the
+ * original loop's before timing, and marked if it differs.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "decode.h"
+#include "kernels.h"
+#include "palette.h"
+#include "record.h"
+#include "fft.h"
+#include "overlay.h"
+#include "scale.h"
+#include "trend.h"
+#include "tty.h"
+#include "waveform.h"
+#include "zoom.h"
+#include "stats.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#ifndef BUILD_CONFIG
+#define BUILD_CONFIG "unknown"  /* the Makefile says which configuration */
+#endif
+
+#define BENCH_ITERATIONS 300
+#define BENCH_WARMUP 20
+#define BENCH_MAX_FRAMES 64  /* of a recording, cycled through */
+
+#define RGB_SIZE (FRAME_PIXELS*3)
+
+static const struct {
+    int w, h;
+} window_sizes[] = {{640, 480}, {960, 720}, {1280, 960}, {1920, 1080}};
+
+struct input {
+    const char * name;
+    int count;
+    uint8_t * dumps;
+};
+
+/* the pattern the test scopes send, plus noise and an idle screen */
+static void synthetic_input(struct input * in) {
+    int f, i;
+
+    in->name = "synthetic";
+    in->count = 3;
+    in->dumps = malloc((size_t) in->count * SCREEN_DUMP_SIZE);
+    srand(1);
+    for (i = 0; i < SCREEN_DUMP_SIZE; i++) {
+	in->dumps[i] = (i * 7) & 0xff;
+	in->dumps[SCREEN_DUMP_SIZE + i] = rand();
+	in->dumps[2 * SCREEN_DUMP_SIZE + i] = i % RASTER_PITCH == 60
+	    || i / RASTER_PITCH % 40 == 0 ? 0x77 : 0x00;
+    }
+    for (f = 0; f < in->count; f++) {
+	for (i = 0; i < SCREEN_DUMP_SIZE; i++) {
+	    if (i % RASTER_PITCH >= RASTER_USED) {
+		in->dumps[f * SCREEN_DUMP_SIZE + i] = 0;
+	    }
+	}
+    }
+}
+
+/* returns 0 on success */
+static int recorded_input(struct input * in, const char * path) {
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    static uint8_t indexed[FRAME_PIXELS];
+    struct record_header hdr;
+    recording r;
+
+    in->name = "recorded";
+    in->count = 0;
+    in->dumps = malloc((size_t) BENCH_MAX_FRAMES * SCREEN_DUMP_SIZE);
+    if (!in->dumps || record_open(&r, path)) {
+	return 1;
+    }
+    while (in->count < BENCH_MAX_FRAMES
+	   && record_read(&r, &hdr, packed) == 1) {
+	decode_unpack(packed, indexed);
+	encode_dump(indexed, in->dumps + (size_t) in->count++
+		    * SCREEN_DUMP_SIZE);
+    }
+    record_close(&r);
+    return in->count == 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void report(const char * kernel, const char * input, double * ns,
+		   double * cyc, int count, double bytes, int differs) {
+    stats_summary s, c;
+
+    stats_summarize(ns, count, &s);
+    stats_summarize(cyc, count, &c);
+    printf("%-22s %-10s %10.0f %10.0f %9.0f %8.1f%%", kernel, input, s.p50,
+	   s.mean, s.stddev, s.mean > 0 ? 100 * s.stddev / s.mean : 0);
+    if (c.p50 > 0) {
+	printf(" %8.3f", bytes / c.p50);
+    } else {
+	printf(" %8s", "n/a");
+    }
+    printf("%s\n", differs ? "  DIFFERS FROM ORIGINAL" : "");
+}
+
+static void bench_kernels(const struct input * in, int iterations,
+			  const palette_lut * lut, const rgb_color * colors) {
+    static uint8_t expect[RGB_SIZE], rgb[RGB_SIZE];
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    const uint8_t * dump;
+    uint64_t t0, c0;
+    int k, i, f, differs;
+
+    for (k = 0; k < kernel_count; k++) {
+	differs = 0;
+	for (f = 0; f < in->count; f++) {
+	    dump = in->dumps + (size_t) f * SCREEN_DUMP_SIZE;
+	    kernels[0].run(dump, lut, colors, expect);  /* the original */
+	    kernels[k].run(dump, lut, colors, rgb);
+	    differs |= memcmp(expect, rgb, RGB_SIZE) != 0;
+	}
+	for (i = -BENCH_WARMUP; i < iterations; i++) {
+	    dump = in->dumps + (size_t) ((i + BENCH_WARMUP) % in->count)
+		* SCREEN_DUMP_SIZE;
+	    t0 = now_ns();
+	    c0 = cycles();
+	    kernels[k].run(dump, lut, colors, rgb);
+	    if (i >= 0) {
+		cyc[i] = cycles() - c0;
+		ns[i] = now_ns() - t0;
+	    }
+	}
+	report(kernels[k].name, in->name, ns, cyc, iterations,
+	       SCREEN_DUMP_SIZE, differs);
+    }
+    free(ns);
+    free(cyc);
+}
+
+/* the scaling step: indexed frame to a window sized RGB picture */
+static void bench_scale(const struct input * in, int iterations,
+			const palette_lut * lut) {
+    static uint8_t indexed[FRAME_PIXELS];
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    uint8_t * scaled, * rgb;
+    char name[32];
+    scale_map m;
+    uint64_t t0, c0;
+    int s, i, size;
+
+    for (s = 0; s < (int) (sizeof(window_sizes) / sizeof(window_sizes[0]));
+	 s++) {
+	size = window_sizes[s].w * window_sizes[s].h;
+	scaled = malloc(size);
+	rgb = malloc(size * 3);
+	scale_init(&m, FRAME_WIDTH, FRAME_HEIGHT, window_sizes[s].w,
+		   window_sizes[s].h);
+	for (i = -BENCH_WARMUP; i < iterations; i++) {
+	    decode_indexed(in->dumps + (size_t) ((i + BENCH_WARMUP)
+						 % in->count)
+			   * SCREEN_DUMP_SIZE, indexed);
+	    t0 = now_ns();
+	    c0 = cycles();
+	    scale_indexed(&m, indexed, scaled);
+	    palette_lut_indexed(lut, scaled, rgb, size);
+	    if (i >= 0) {
+		cyc[i] = cycles() - c0;
+		ns[i] = now_ns() - t0;
+	    }
+	}
+	snprintf(name, sizeof(name), "scale %dx%d", window_sizes[s].w,
+		 window_sizes[s].h);
+	report(name, in->name, ns, cyc, iterations, FRAME_PIXELS, 0);
+	scale_free(&m);
+	free(scaled);
+	free(rgb);
+    }
+    free(ns);
+    free(cyc);
+}
+
+/* the viewer's zoomed view, at 1x and close up, over changing frames */
+static void bench_zoom(const struct input * in, int iterations,
+		       const palette_lut * lut) {
+    static const int factors[] = {1, 8};
+    static uint8_t indexed[FRAME_PIXELS];
+    static zoom_view z;
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    uint8_t * rgb;
+    char name[32];
+    uint64_t t0, c0;
+    int s, f, i, w, h;
+
+    for (s = 0; s < (int) (sizeof(window_sizes) / sizeof(window_sizes[0]));
+	 s++) {
+	rgb = malloc(window_sizes[s].w * window_sizes[s].h * 3);
+	for (f = 0; f < (int) (sizeof(factors) / sizeof(factors[0])); f++) {
+	    w = FRAME_WIDTH / factors[f];
+	    h = FRAME_HEIGHT / factors[f];
+	    zoom_set(&z, (FRAME_WIDTH - w) / 2, (FRAME_HEIGHT - h) / 2, w, h,
+		     window_sizes[s].w, window_sizes[s].h);
+	    for (i = -BENCH_WARMUP; i < iterations; i++) {
+		decode_indexed(in->dumps + (size_t) ((i + BENCH_WARMUP)
+						     % in->count)
+			       * SCREEN_DUMP_SIZE, indexed);
+		t0 = now_ns();
+		c0 = cycles();
+		zoom_render(&z, indexed, lut->rgb, rgb, window_sizes[s].w * 3);
+		if (i >= 0) {
+		    cyc[i] = cycles() - c0;
+		    ns[i] = now_ns() - t0;
+		}
+	    }
+	    snprintf(name, sizeof(name), "zoom %dx %dx%d", factors[f],
+		     window_sizes[s].w, window_sizes[s].h);
+	    report(name, in->name, ns, cyc, iterations, FRAME_PIXELS, 0);
+	}
+	zoom_free(&z);
+	free(rgb);
+    }
+    free(ns);
+    free(cyc);
+}
+
+/* pairing each frame with a reference, as the viewer's overlay does */
+static void bench_overlay(const struct input * in, int iterations) {
+    static uint8_t indexed[FRAME_PIXELS], reference[FRAME_PIXELS];
+    static uint8_t composite[FRAME_PIXELS];
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    uint64_t t0, c0;
+    int i;
+
+    decode_indexed(in->dumps, reference);
+    for (i = -BENCH_WARMUP; i < iterations; i++) {
+	decode_indexed(in->dumps + (size_t) ((i + BENCH_WARMUP) % in->count)
+		       * SCREEN_DUMP_SIZE, indexed);
+	t0 = now_ns();
+	c0 = cycles();
+	overlay_compose(indexed, reference, composite, FRAME_PIXELS);
+	if (i >= 0) {
+	    cyc[i] = cycles() - c0;
+	    ns[i] = now_ns() - t0;
+	}
+    }
+    report("overlay compose", in->name, ns, cyc, iterations, FRAME_PIXELS, 0);
+    free(ns);
+    free(cyc);
+}
+
+/* the viewer's spectrum pane: both traces read off the frame and transformed */
+static void bench_spectrum(const struct input * in, int iterations) {
+    static uint8_t indexed[FRAME_PIXELS];
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    float samples[WAVE_W] = {0}, db[257];
+    fft_plan p;
+    uint64_t t0, c0;
+    int i, c;
+
+    fft_init(&p, 512);
+    for (i = -BENCH_WARMUP; i < iterations; i++) {
+	decode_indexed(in->dumps + (size_t) ((i + BENCH_WARMUP) % in->count)
+		       * SCREEN_DUMP_SIZE, indexed);
+	t0 = now_ns();
+	c0 = cycles();
+	for (c = 0; c < WAVE_CHANNELS; c++) {
+	    waveform_extract(indexed, wave_colors[c], samples);
+	    fft_spectrum(&p, samples, WAVE_W, WAVE_H / 2.0f, db);
+	}
+	if (i >= 0) {
+	    cyc[i] = cycles() - c0;
+	    ns[i] = now_ns() - t0;
+	}
+    }
+    report("spectrum", in->name, ns, cyc, iterations, FRAME_PIXELS, 0);
+    fft_free(&p);
+    free(ns);
+    free(cyc);
+}
+
+/* the viewer's --tty output, each frame against the one before it */
+static void bench_tty(const struct input * in, int iterations,
+		      const palette_lut * lut) {
+    static const struct {
+	const char * name;
+	int cols, rows;
+    } sizes[] = {{"tty 80x24", 80, 23}, {"tty 320x121", 320, 120}};
+    static uint8_t indexed[FRAME_PIXELS];
+    static tty_view t;
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    uint64_t t0, c0;
+    unsigned int k;
+    int i;
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+	tty_set(&t, sizes[k].cols, sizes[k].rows);
+	for (i = -BENCH_WARMUP; i < iterations; i++) {
+	    decode_indexed(in->dumps
+			   + (size_t) ((i + BENCH_WARMUP) % in->count)
+			   * SCREEN_DUMP_SIZE, indexed);
+	    t0 = now_ns();
+	    c0 = cycles();
+	    tty_render(&t, indexed, lut->rgb);
+	    if (i >= 0) {
+		cyc[i] = cycles() - c0;
+		ns[i] = now_ns() - t0;
+	    }
+	}
+	report(sizes[k].name, in->name, ns, cyc, iterations, FRAME_PIXELS, 0);
+    }
+    tty_free(&t);
+    free(ns);
+    free(cyc);
+}
+
+/*
+ * trend plots of a readout sampled every frame for a shift and for a week,
+ * which should cost the same
+ */
+static void bench_trend(int iterations) {
+    static const struct {
+	const char * name;
+	uint64_t hours;
+    } spans[] = {{"trend 8h", 8}, {"trend week", 7 * 24}};
+    double * ns = calloc(iterations, sizeof(double));
+    double * cyc = calloc(iterations, sizeof(double));
+    double min[WAVE_W], max[WAVE_W];
+    uint64_t t0, c0, n, end, start;
+    trend_series s;
+    unsigned int k;
+    int i;
+
+    for (k = 0; k < sizeof(spans) / sizeof(spans[0]); k++) {
+	memset(&s, 0, sizeof(s));
+	end = spans[k].hours * 3600 * 4;
+	for (n = 0; n < end; n++) {
+	    trend_add(&s, n * 250000, 1e3 + (n * 2654435761u % 1000) / 1e3);
+	}
+	for (i = -BENCH_WARMUP; i < iterations; i++) {
+	    /* the whole span, then windows down to a minute */
+	    start = (i & 7) ? (end - 240 * (1 << (i & 7))) * 250000 : 0;
+	    t0 = now_ns();
+	    c0 = cycles();
+	    trend_plot(&s, start, (end - 1) * 250000, WAVE_W, min, max);
+	    if (i >= 0) {
+		cyc[i] = cycles() - c0;
+		ns[i] = now_ns() - t0;
+	    }
+	}
+	report(spans[k].name, "synthetic", ns, cyc, iterations,
+	       WAVE_W * 2 * sizeof(double), 0);
+	trend_free(&s);
+    }
+    free(ns);
+    free(cyc);
+}
+
+int main(int argc, char *argv[]) {
+    struct input inputs[2];
+    int opt, i, count = 1, iterations = BENCH_ITERATIONS;
+    palette_lut lut;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    iterations = atoi(optarg);
+	    break;
+	default:
+	    printf("usage: %s [-n ITERATIONS] [in.svr]\n", argv[0]);
+	    return 1;
+	}
+    }
+    if (iterations < 1) {
+	iterations = 1;
+    }
+    synthetic_input(&inputs[0]);
+    if (optind < argc) {
+	if (recorded_input(&inputs[1], argv[optind])) {
+	    printf("error reading %s\n", argv[optind]);
+	    return 1;
+	}
+	count = 2;
+    }
+    palette_lut_init(&lut, color_themes[0]);
+
+    printf("build: %s\n", BUILD_CONFIG);
+    printf("%-22s %-10s %10s %10s %9s %9s %8s\n", "kernel", "input",
+	   "p50 ns", "mean ns", "stddev", "cv", "B/cycle");
+    for (i = 0; i < count; i++) {
+	bench_kernels(&inputs[i], iterations, &lut, color_themes[0]);
+    }
+    for (i = 0; i < count; i++) {
+	bench_scale(&inputs[i], iterations, &lut);
+	bench_zoom(&inputs[i], iterations, &lut);
+	bench_overlay(&inputs[i], iterations);
+	bench_spectrum(&inputs[i], iterations);
+	bench_tty(&inputs[i], iterations, &lut);
+    }
+    bench_trend(iterations);
+    for (i = 0; i < count; i++) {
+	free(inputs[i].dumps);
+    }
+    return 0;
+}
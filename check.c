@@ -0,0 +1,133 @@
+/*
+ * About : Golden output tests for the frame kernels, see kernels.h.
+ *
+ * Usage : scopecheck [-g]
+ *
+ *         Feeds a fixed set of screen dumps through every kernel in every
+ *         color theme and compares a hash of each picture with the one the
+ *         original loop gave when the table below was made. Prints what
+ *         differs and exits nonzero if anything does. "make check" builds
+ *         and runs it.
+ *
+ *         -g prints the table anew from the original loop, for when the
+ *         corpus changes (the original loop itself never should).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "decode.h"
+#include "frameid.h"
+#include "kernels.h"
+#include "palette.h"
+
+#define CORPUS_FRAMES 6
+
+static const char * corpus_names[CORPUS_FRAMES] = {
+    "pattern", "noise", "idle", "emulated", "black", "white"};
+
+/* FNV-1a of the original loop's output, by frame and then by theme */
+static const uint64_t golden[CORPUS_FRAMES][COLOR_THEME_COUNT] = {
+    {0x58e0e505b9617725ULL, 0xb69ccbe135fd93e5ULL, 0x961285048c5611a5ULL, 0x5b5dae9fc9d55fe5ULL},
+    {0x07ab253d789e79e7ULL, 0x948d49de9ca68feeULL, 0xa17c82a8c94d2ef9ULL, 0x6dca2e7bc100e438ULL},
+    {0x46d35f3128a57025ULL, 0x4f975a4f5da36f25ULL, 0x326e0739b4ae7325ULL, 0xd6ba82d3c5dee8a5ULL},
+    {0x27f5604f0396131eULL, 0x69e3af7f80e73e6cULL, 0xdcb3a49e3c9793a0ULL, 0x8ecaf1c6d54d1ff9ULL},
+    {0xbaeab7cba4b28f25ULL, 0x4f975a4f5da36f25ULL, 0x326e0739b4ae7325ULL, 0x326e0739b4ae7325ULL},
+    {0x090a511c5c578b25ULL, 0x77f4663c9e2a4325ULL, 0x21b7cbd47f991725ULL, 0x21b7cbd47f991725ULL}
+};
+
+/* our own generator, so the corpus is the same everywhere */
+static uint32_t lcg(uint32_t * state) {
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 24;
+}
+
+static void corpus_frame(int n, uint8_t * dump) {
+    static uint8_t indexed[FRAME_PIXELS];
+    uint32_t state = 12345;
+    int i, x;
+
+    for (i = 0; i < SCREEN_DUMP_SIZE; i++) {
+	switch (n) {
+	case 0:
+	    dump[i] = (i * 7) & 0xff;
+	    break;
+	case 1:
+	    dump[i] = lcg(&state);
+	    break;
+	case 2:
+	    dump[i] = i % RASTER_PITCH == 60 || i / RASTER_PITCH % 40 == 0
+		? 0x77 : 0x00;
+	    break;
+	case 4:
+	    dump[i] = 0x00;
+	    break;
+	default:
+	    dump[i] = 0xff;
+	    break;
+	}
+    }
+    if (n == 3) {
+	/* a graticule and a ramp, stamped the way scopeemu does */
+	for (i = 0; i < FRAME_PIXELS; i++) {
+	    x = i % FRAME_WIDTH;
+	    indexed[i] = x % 40 == 0 || i / FRAME_WIDTH % 40 == 0 ? 1
+		: (x + i / FRAME_WIDTH) % 16;
+	}
+	frameid_stamp(indexed, 0x1234567);
+	encode_dump(indexed, dump);
+    }
+}
+
+static uint64_t fnv1a(const uint8_t * data, size_t length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+	h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t dump[SCREEN_DUMP_SIZE];
+    static uint8_t rgb[FRAME_PIXELS*3];
+    int generate = argc > 1 && !strcmp(argv[1], "-g");
+    int f, t, k, failures = 0, checks = 0;
+    palette_lut lut;
+    uint64_t h;
+
+    for (f = 0; f < CORPUS_FRAMES; f++) {
+	corpus_frame(f, dump);
+	if (generate) {
+	    printf("    {");
+	}
+	for (t = 0; t < COLOR_THEME_COUNT; t++) {
+	    palette_lut_init(&lut, color_themes[t]);
+	    /* kernels[0] is the original loop */
+	    for (k = 0; k < (generate ? 1 : kernel_count); k++) {
+		memset(rgb, 0xa5, sizeof(rgb)); /* catch pixels left alone */
+		kernels[k].run(dump, &lut, color_themes[t], rgb);
+		h = fnv1a(rgb, sizeof(rgb));
+		if (generate) {
+		    printf("0x%016llxULL%s", (unsigned long long) h,
+			   t + 1 < COLOR_THEME_COUNT ? ", " : "");
+		    continue;
+		}
+		checks++;
+		if (h != golden[f][t]) {
+		    printf("FAIL %s: %s frame in %s\n", kernels[k].name,
+			   corpus_names[f], theme_names[t]);
+		    failures++;
+		}
+	    }
+	}
+	if (generate) {
+	    printf("}%s\n", f + 1 < CORPUS_FRAMES ? "," : "");
+	}
+    }
+    if (!generate) {
+	printf("%d of %d kernel outputs match the original loop\n",
+	       checks - failures, checks);
+    }
+    return failures != 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * About : Client side of the scopeviewd socket, see proto.h.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "client.h"
+
+/* returns 0 on success */
+int client_connect(scope_client * c, const char * path) {
+    struct sockaddr_un addr;
+
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+	return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (c->fd == -1) {
+	return 1;
+    }
+    if (connect(c->fd, (struct sockaddr *) &addr, sizeof(addr))) {
+	close(c->fd);
+	c->fd = -1;
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ * read what is available of the next message. returns 1 once c->hdr and
+ * c->payload hold a complete message, 0 if a non-blocking socket has no more
+ * data yet (or a signal interrupted the wait), or -1 if the daemon went away
+ * or sent garbage.
+ */
+int client_recv(scope_client * c) {
+    uint8_t * dst;
+    size_t want;
+    ssize_t n;
+
+    if (c->ready) {
+	c->ready = 0;
+	c->have = 0;
+    }
+    while (1) {
+	if (c->have < sizeof(c->hdr)) {
+	    dst = (uint8_t *) &c->hdr + c->have;
+	    want = sizeof(c->hdr) - c->have;
+	} else {
+	    if (c->hdr.magic != PROTO_MAGIC
+		|| c->hdr.length > PROTO_MAX_PAYLOAD) {
+		return -1;
+	    }
+	    if (c->have - sizeof(c->hdr) == c->hdr.length) {
+		c->ready = 1;
+		return 1;
+	    }
+	    dst = c->payload + (c->have - sizeof(c->hdr));
+	    want = c->hdr.length - (c->have - sizeof(c->hdr));
+	}
+	n = read(c->fd, dst, want);
+	if (n == 0) {
+	    return -1;
+	} else if (n < 0) {
+	    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		? 0 : -1;
+	}
+	c->have += n;
+    }
+}
+
+/* queue a scope command on the daemon, see proto.h. returns 0 on success */
+int client_command(scope_client * c, uint64_t id, int flags,
+		   uint32_t deadline_ms, const char * cmd, size_t length) {
+    uint8_t msg[sizeof(struct proto_header) + CMD_MAX];
+    struct proto_header * hdr = (struct proto_header *) msg;
+    size_t off = 0;
+    ssize_t n;
+
+    if (length > CMD_MAX) {
+	return 1;
+    }
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = PROTO_MAGIC;
+    hdr->type = MSG_COMMAND;
+    hdr->flags = flags;
+    hdr->length = length;
+    hdr->arg = deadline_ms;
+    hdr->seq = id;
+    memcpy(msg + sizeof(*hdr), cmd, length);
+
+    while (off < sizeof(*hdr) + length) {
+	n = send(c->fd, msg + off, sizeof(*hdr) + length - off, MSG_NOSIGNAL);
+	if (n < 0) {
+	    if (errno == EINTR || errno == EAGAIN) {
+		continue;
+	    }
+	    return 1;
+	}
+	off += n;
+    }
+    return 0;
+}
+
+void client_close(scope_client * c) {
+    if (c->fd != -1) {
+	close(c->fd);
+	c->fd = -1;
+    }
+}
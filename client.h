@@ -0,0 +1,25 @@
+/*
+ * About : Client side of the scopeviewd socket, see proto.h.
+ */
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stddef.h>
+#include "proto.h"
+
+typedef struct {
+    int fd;
+    size_t have;  /* bytes of the current message received so far */
+    int ready;
+    struct proto_header hdr;
+    uint8_t payload[PROTO_MAX_PAYLOAD];
+} scope_client;
+
+int client_connect(scope_client * c, const char * path);
+int client_recv(scope_client * c);
+int client_command(scope_client * c, uint64_t id, int flags,
+		   uint32_t deadline_ms, const char * cmd, size_t length);
+void client_close(scope_client * c);
+
+#endif
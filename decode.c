@@ -0,0 +1,52 @@
+/*
+ * About : Unpack GDS-820C screen dumps, see decode.h for the layout.
+ */
+
+#include "decode.h"
+
+/* rotate a raw dump into an indexed frame, one color index per byte */
+void decode_indexed(const uint8_t * dump, uint8_t * indexed) {
+    int byte_cnt, row, col;
+
+    for (byte_cnt = 0; byte_cnt < SCREEN_DUMP_SIZE; byte_cnt++) {
+	row = byte_cnt % RASTER_PITCH;
+	col = (INPUT_WIDTH - 1) - byte_cnt / RASTER_PITCH;
+	if (row < RASTER_USED) {
+	    indexed[(row * 2) * FRAME_WIDTH + col] = dump[byte_cnt] >> 4;
+	    indexed[(row * 2 + 1) * FRAME_WIDTH + col] = dump[byte_cnt] & 0x0f;
+	}
+    }
+}
+
+void decode_pack(const uint8_t * indexed, uint8_t * packed) {
+    int i;
+
+    for (i = 0; i < FRAME_PACKED_SIZE; i++) {
+	packed[i] = (indexed[2 * i] << 4) | (indexed[2 * i + 1] & 0x0f);
+    }
+}
+
+void decode_unpack(const uint8_t * packed, uint8_t * indexed) {
+    int i;
+
+    for (i = 0; i < FRAME_PACKED_SIZE; i++) {
+	indexed[2 * i] = packed[i] >> 4;
+	indexed[2 * i + 1] = packed[i] & 0x0f;
+    }
+}
+
+/* the inverse of decode_indexed(), as a scope would send the frame */
+void encode_dump(const uint8_t * indexed, uint8_t * dump) {
+    int byte_cnt, row, col;
+
+    for (byte_cnt = 0; byte_cnt < SCREEN_DUMP_SIZE; byte_cnt++) {
+	row = byte_cnt % RASTER_PITCH;
+	col = (INPUT_WIDTH - 1) - byte_cnt / RASTER_PITCH;
+	if (row < RASTER_USED) {
+	    dump[byte_cnt] = indexed[(row * 2) * FRAME_WIDTH + col] << 4
+		| (indexed[(row * 2 + 1) * FRAME_WIDTH + col] & 0x0f);
+	} else {
+	    dump[byte_cnt] = 0;
+	}
+    }
+}
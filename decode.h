@@ -0,0 +1,37 @@
+/*
+ * About : Screen dump geometry and pixel unpacking for the GDS-820C.
+ *
+ * Notes :
+ *
+ * A screen dump is SCREEN_DUMP_SIZE bytes of 4 bit color indices, sent as
+ * 320 vertical rasters of RASTER_PITCH bytes each (2 pixels/byte, high
+ * nibble first). Only the first RASTER_USED bytes of each raster are visible,
+ * the rest is padding below the 240th row.
+ *
+ * An "indexed" frame is the same picture rotated to normal viewing
+ * orientation, stored row-major at one byte (color index 0-15) per pixel.
+ * A "packed" frame is an indexed frame at 2 pixels/byte, left pixel in the
+ * high nibble, which is how frames travel between processes.
+ */
+
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <stdint.h>
+
+#define INPUT_WIDTH 320  /* scope gives us 320 pixels per row */
+#define SCREEN_DUMP_SIZE 40960
+#define RASTER_PITCH 128  /* bytes per vertical raster */
+#define RASTER_USED 120  /* skip the last 8 bytes (16 rows) of each raster */
+
+#define FRAME_WIDTH 320
+#define FRAME_HEIGHT 240
+#define FRAME_PIXELS (FRAME_WIDTH*FRAME_HEIGHT)
+#define FRAME_PACKED_SIZE (FRAME_PIXELS/2)
+
+void decode_indexed(const uint8_t * dump, uint8_t * indexed);
+void decode_pack(const uint8_t * indexed, uint8_t * packed);
+void decode_unpack(const uint8_t * packed, uint8_t * indexed);
+void encode_dump(const uint8_t * indexed, uint8_t * dump);
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * About : Convert frames to raw video for external encoders.
+ *
+ * Notes :
+ *
+ * Frames go through a three stage pipeline: the calling thread reads packed
+ * frames from the source, a pool of worker threads unpacks, scales and color
+ * converts them, and a writer thread puts them out in their original order.
+ * Jobs live in a small ring of slots, so reading, converting and writing
+ * all overlap and memory use stays fixed however long the input is.
+ *
+ * Conversion uses the palette lookup tables and indexed scaling from
+ * palette.c and scale.c: at 1:1 a packed byte maps straight to two RGB
+ * pixels, otherwise the frame is scaled as color indices first and only the
+ * output pixels are looked up.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "export.h"
+#include "scale.h"
+
+#define SLOTS_PER_JOB 2
+
+enum { SLOT_FREE, SLOT_READY, SLOT_BUSY, SLOT_DONE };
+
+struct slot {
+    int state;
+    uint8_t packed[FRAME_PACKED_SIZE];
+    uint8_t * out;  /* converted frame, including any per-frame header */
+};
+
+struct pipeline {
+    const export_options * opt;
+    palette_lut lut;
+    scale_map map;
+    size_t out_size;
+    size_t header_size;  /* "FRAME\n" for Y4M */
+    struct slot * slots;
+    int slot_count;
+    uint64_t queued;  /* frames handed in by the reader */
+    uint64_t converting;  /* next frame for a worker to take */
+    uint64_t written;
+    int finished;  /* reader has handed in everything */
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void convert(struct pipeline * p, struct slot * s, uint8_t * indexed,
+		    uint8_t * scaled) {
+    const export_options * opt = p->opt;
+    uint8_t * out = s->out + p->header_size;
+    int count = opt->width * opt->height;
+    const uint8_t * src;
+    int i;
+
+    if (opt->format == EXPORT_RGB && opt->width == FRAME_WIDTH
+	&& opt->height == FRAME_HEIGHT) {
+	palette_lut_packed(&p->lut, s->packed, out, FRAME_PACKED_SIZE);
+	return;
+    }
+    decode_unpack(s->packed, indexed);
+    src = indexed;
+    if (opt->width != FRAME_WIDTH || opt->height != FRAME_HEIGHT) {
+	scale_indexed(&p->map, indexed, scaled);
+	src = scaled;
+    }
+    if (opt->format == EXPORT_RGB) {
+	palette_lut_indexed(&p->lut, src, out, count);
+	return;
+    }
+    /* planar Y, Cb, Cr */
+    for (i = 0; i < count; i++) {
+	out[i] = p->lut.y[src[i]];
+	out[count + i] = p->lut.cb[src[i]];
+	out[2 * count + i] = p->lut.cr[src[i]];
+    }
+}
+
+static void * worker_thread(void * arg) {
+    struct pipeline * p = arg;
+    uint8_t * indexed = malloc(FRAME_PIXELS);
+    uint8_t * scaled = malloc((size_t) p->opt->width * p->opt->height);
+    struct slot * s;
+
+    pthread_mutex_lock(&p->lock);
+    if (!indexed || !scaled) {
+	p->failed = 1;
+	pthread_cond_broadcast(&p->cond);
+    }
+    while (!p->failed) {
+	if (p->converting == p->queued) {
+	    if (p->finished) {
+		break;
+	    }
+	    pthread_cond_wait(&p->cond, &p->lock);
+	    continue;
+	}
+	s = &p->slots[p->converting++ % p->slot_count];
+	s->state = SLOT_BUSY;
+	pthread_mutex_unlock(&p->lock);
+
+	convert(p, s, indexed, scaled);
+
+	pthread_mutex_lock(&p->lock);
+	s->state = SLOT_DONE;
+	pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    free(indexed);
+    free(scaled);
+    return NULL;
+}
+
+static void * writer_thread(void * arg) {
+    struct pipeline * p = arg;
+    struct slot * s;
+    int ok;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->failed) {
+	s = &p->slots[p->written % p->slot_count];
+	if (p->written == p->queued && p->finished) {
+	    break;
+	}
+	if (p->written == p->queued || s->state != SLOT_DONE) {
+	    pthread_cond_wait(&p->cond, &p->lock);
+	    continue;
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	ok = fwrite(s->out, p->out_size, 1, p->opt->out) == 1;
+
+	pthread_mutex_lock(&p->lock);
+	if (!ok) {
+	    p->failed = 1;
+	}
+	s->state = SLOT_FREE;
+	p->written++;
+	pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/*
+ * convert every frame next() delivers and write it to opt->out. returns 0 if
+ * all of them made it out, and the number written in *frames either way.
+ */
+int export_run(const export_options * opt, export_source next, void * ctx,
+	       uint64_t * frames) {
+    struct pipeline p;
+    pthread_t * workers;
+    pthread_t writer;
+    struct slot * s;
+    int i, started = 0, writing = 0, rv = 0;
+
+    memset(&p, 0, sizeof(p));
+    p.opt = opt;
+    palette_lut_init(&p.lut, opt->colors);
+    if (scale_init(&p.map, FRAME_WIDTH, FRAME_HEIGHT, opt->width,
+		   opt->height)) {
+	return 1;
+    }
+    p.header_size = opt->format == EXPORT_Y4M ? 6 : 0;
+    p.out_size = p.header_size + (size_t) opt->width * opt->height * 3;
+    p.slot_count = opt->jobs * SLOTS_PER_JOB + 1;
+    p.slots = calloc(p.slot_count, sizeof(struct slot));
+    workers = calloc(opt->jobs, sizeof(pthread_t));
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.cond, NULL);
+    for (i = 0; p.slots && i < p.slot_count; i++) {
+	p.slots[i].out = malloc(p.out_size);
+	if (!p.slots[i].out) {
+	    p.failed = 1;
+	} else if (p.header_size) {
+	    memcpy(p.slots[i].out, "FRAME\n", 6);
+	}
+    }
+    if (!p.slots || !workers || p.failed) {
+	p.failed = 1;
+	goto done;
+    }
+
+    if (opt->format == EXPORT_Y4M) {
+	fprintf(opt->out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n",
+		opt->width, opt->height, opt->fps);
+    }
+    for (started = 0; started < opt->jobs; started++) {
+	if (pthread_create(&workers[started], NULL, worker_thread, &p)) {
+	    p.failed = 1;
+	    break;
+	}
+    }
+    if (!p.failed) {
+	writing = !pthread_create(&writer, NULL, writer_thread, &p);
+	p.failed = !writing;
+    }
+
+    pthread_mutex_lock(&p.lock);
+    while (!p.failed) {
+	s = &p.slots[p.queued % p.slot_count];
+	if (s->state != SLOT_FREE) {
+	    pthread_cond_wait(&p.cond, &p.lock);
+	    continue;
+	}
+	pthread_mutex_unlock(&p.lock);
+	/* reading the source outside the lock keeps workers going */
+	rv = next(ctx, s->packed);
+	pthread_mutex_lock(&p.lock);
+	if (rv != 1) {
+	    p.failed |= rv < 0;
+	    break;
+	}
+	s->state = SLOT_READY;
+	p.queued++;
+	pthread_cond_broadcast(&p.cond);
+    }
+    p.finished = 1;
+    pthread_cond_broadcast(&p.cond);
+    pthread_mutex_unlock(&p.lock);
+
+    for (i = 0; i < started; i++) {
+	pthread_join(workers[i], NULL);
+    }
+    if (writing) {
+	pthread_join(writer, NULL);
+    }
+
+done:
+    for (i = 0; p.slots && i < p.slot_count; i++) {
+	free(p.slots[i].out);
+    }
+    free(p.slots);
+    free(workers);
+    scale_free(&p.map);
+    if (frames) {
+	*frames = p.written;
+    }
+    return p.failed || fflush(opt->out) != 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * About : Convert frames to raw video for external encoders, see export.c.
+ */
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "palette.h"
+
+enum {
+    EXPORT_Y4M,  /* YUV4MPEG2, 4:4:4 */
+    EXPORT_RGB  /* headerless 24 bit RGB frames */
+};
+
+typedef struct {
+    int format;
+    int width, height;  /* output size */
+    int fps;  /* frame rate written into the Y4M header */
+    int jobs;  /* conversion threads */
+    const rgb_color * colors;
+    FILE * out;
+} export_options;
+
+/* fetch the next packed frame: 1 if there is one, 0 at the end, -1 on error */
+typedef int (*export_source)(void * ctx, uint8_t * packed);
+
+int export_run(const export_options * opt, export_source next, void * ctx,
+	       uint64_t * frames);
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * About : Radix-2 FFT and amplitude spectra, see fft.h.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fft.h"
+
+/* n must be a power of two. returns 0 on success */
+int fft_init(fft_plan * p, int n) {
+    int i, m, k, bits = 0;
+
+    memset(p, 0, sizeof(*p));
+    if (n < 2 || (n & (n - 1))) {
+	return 1;
+    }
+    while ((1 << bits) < n) {
+	bits++;
+    }
+    p->n = n;
+    p->reverse = malloc(n * sizeof(int));
+    p->cos = malloc(n * sizeof(float));
+    p->sin = malloc(n * sizeof(float));
+    p->re = malloc(n * sizeof(float));
+    p->im = malloc(n * sizeof(float));
+    if (!p->reverse || !p->cos || !p->sin || !p->re || !p->im) {
+	fft_free(p);
+	return 1;
+    }
+    for (i = 0; i < n; i++) {
+	p->reverse[i] = 0;
+	for (k = 0; k < bits; k++) {
+	    p->reverse[i] |= ((i >> k) & 1) << (bits - 1 - k);
+	}
+    }
+    for (m = 1; m < n; m *= 2) {
+	for (k = 0; k < m; k++) {
+	    p->cos[m - 1 + k] = cos(M_PI * k / m);
+	    p->sin[m - 1 + k] = -sin(M_PI * k / m);
+	}
+    }
+    return 0;
+}
+
+/* in place, forward, unscaled */
+void fft_forward(const fft_plan * p, float * re, float * im) {
+    const float * wr, * wi;
+    float * restrict ar, * restrict ai, * restrict br, * restrict bi;
+    float t, tr, ti;
+    int i, j, k, m;
+
+    for (i = 0; i < p->n; i++) {
+	j = p->reverse[i];
+	if (i < j) {
+	    t = re[i], re[i] = re[j], re[j] = t;
+	    t = im[i], im[i] = im[j], im[j] = t;
+	}
+    }
+    for (m = 1; m < p->n; m *= 2) {
+	wr = p->cos + m - 1;
+	wi = p->sin + m - 1;
+	for (j = 0; j < p->n; j += 2 * m) {
+	    ar = re + j;
+	    ai = im + j;
+	    br = re + j + m;
+	    bi = im + j + m;
+	    for (k = 0; k < m; k++) {
+		tr = br[k] * wr[k] - bi[k] * wi[k];
+		ti = br[k] * wi[k] + bi[k] * wr[k];
+		br[k] = ar[k] - tr;
+		bi[k] = ai[k] - ti;
+		ar[k] += tr;
+		ai[k] += ti;
+	    }
+	}
+    }
+}
+
+/*
+ * amplitude spectrum of count samples (count <= n), Hann windowed and
+ * zero padded, into n / 2 + 1 bins of db. a sine of amplitude full_scale
+ * reads about 0 dB.
+ */
+void fft_spectrum(const fft_plan * p, const float * samples, int count,
+		  float full_scale, float * db) {
+    float mean = 0, w, gain = 0, a;
+    int i;
+
+    for (i = 0; i < count; i++) {
+	mean += samples[i];
+    }
+    mean /= count;
+    for (i = 0; i < p->n; i++) {
+	w = i < count ? 0.5f - 0.5f * cosf(2 * M_PI * i / count) : 0;
+	p->re[i] = i < count ? (samples[i] - mean) * w : 0;
+	p->im[i] = 0;
+	gain += w;
+    }
+    fft_forward(p, p->re, p->im);
+    gain = gain * full_scale / 2;
+    for (i = 0; i <= p->n / 2; i++) {
+	a = sqrtf(p->re[i] * p->re[i] + p->im[i] * p->im[i]) / gain;
+	db[i] = a > 0 ? 20 * log10f(a) : FFT_FLOOR;
+	if (db[i] < FFT_FLOOR) {
+	    db[i] = FFT_FLOOR;
+	}
+    }
+}
+
+void fft_free(fft_plan * p) {
+    free(p->reverse);
+    free(p->cos);
+    free(p->sin);
+    free(p->re);
+    free(p->im);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,32 @@
+/*
+ * About : Radix-2 FFT and amplitude spectra of extracted traces.
+ *
+ * Notes :
+ *
+ * An fft_plan holds everything that only depends on the size: the bit
+ * reversal permutation and, for each stage, its twiddle factors side by
+ * side in their own cos and sin arrays. Data is kept the same way, real
+ * and imaginary parts in separate arrays, so every butterfly loop walks
+ * plain float arrays one step at a time and the compiler can vectorize it.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#define FFT_FLOOR -100.0f  /* dB, what a bin with nothing in it shows */
+
+typedef struct {
+    int n;
+    int * reverse;  /* bit reversed index of each input */
+    float * cos;  /* twiddles, stage with m butterflies at [m - 1, 2m - 1) */
+    float * sin;
+    float * re, * im;  /* scratch for fft_spectrum() */
+} fft_plan;
+
+int fft_init(fft_plan * p, int n);
+void fft_forward(const fft_plan * p, float * re, float * im);
+void fft_spectrum(const fft_plan * p, const float * samples, int count,
+		  float full_scale, float * db);
+void fft_free(fft_plan * p);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * About : Frame numbers drawn into the picture, see frameid.h.
+ */
+
+#include <time.h>
+#include "decode.h"
+#include "frameid.h"
+
+#define ON 15
+#define OFF 0
+
+static uint8_t check(uint32_t id) {
+    return ~((id ^ id >> 8 ^ id >> 16 ^ id >> 24) & 0xff) ^ 0x5a;
+}
+
+void frameid_stamp(uint8_t * indexed, uint32_t id) {
+    uint64_t bits = (uint64_t) check(id) << 32 | id;
+    int bit, x, y;
+
+    for (bit = 0; bit < FRAMEID_BITS; bit++) {
+	for (y = 0; y < FRAMEID_BLOCK; y++) {
+	    for (x = 0; x < FRAMEID_BLOCK; x++) {
+		indexed[y * FRAME_WIDTH + bit * FRAMEID_BLOCK + x] =
+		    bits >> bit & 1 ? ON : OFF;
+	    }
+	}
+    }
+}
+
+/* returns 0 with the frame number in id, or 1 if the frame isn't stamped */
+int frameid_read(const uint8_t * indexed, uint32_t * id) {
+    uint64_t bits = 0;
+    int bit;
+
+    for (bit = 0; bit < FRAMEID_BITS; bit++) {
+	/* sample the middle of each square */
+	if (indexed[FRAMEID_BLOCK / 2 * FRAME_WIDTH + bit * FRAMEID_BLOCK
+		    + FRAMEID_BLOCK / 2] >= 8) {
+	    bits |= (uint64_t) 1 << bit;
+	}
+    }
+    *id = bits & 0xffffffff;
+    return (bits >> 32) != check(*id);
+}
+
+/* note that frame id was presented now */
+void frameid_log(FILE * f, uint32_t id) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    fprintf(f, "%u %llu\n", id,
+	    (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
@@ -0,0 +1,30 @@
+/*
+ * About : Frame numbers drawn into the picture, for measuring latency.
+ *
+ * Notes :
+ *
+ * scopeemu stamps each frame it sends with its number, as a strip of
+ * FRAMEID_BLOCK pixel squares along the top left corner, one per bit:
+ * 32 bits of frame number, then 8 bits of check so that a real screen is
+ * not mistaken for a stamped one. Whoever shows or stores the frame can read
+ * the number back, and log when it did with frameid_log().
+ *
+ * The logs are lines of "<frame number> <CLOCK_MONOTONIC nanoseconds>". The
+ * emulator logs when each frame was asked for, so scopetool latency can
+ * line the two up.
+ */
+
+#ifndef FRAMEID_H
+#define FRAMEID_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define FRAMEID_BITS 40  /* 32 bits of number, 8 of check */
+#define FRAMEID_BLOCK 2
+
+void frameid_stamp(uint8_t * indexed, uint32_t id);
+int frameid_read(const uint8_t * indexed, uint32_t * id);
+void frameid_log(FILE * f, uint32_t id);
+
+#endif
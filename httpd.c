@@ -0,0 +1,642 @@
+/*
+ * About : Optional HTTP server streaming the live view to browsers.
+ *
+ * Notes :
+ *
+ * Listens on a loopback TCP port or a Unix socket and serves:
+ *
+ *   /              a page showing the stream
+ *   /stream.mjpeg  multipart/x-mixed-replace stream of JPEG frames
+ *   /stream.png    the same with 4 bit indexed PNG frames (lossless)
+ *   /frame.jpg     the latest frame, once
+ *   /frame.png
+ *
+ * Frames come in from the acquisition thread through httpd_frame(). A frame
+ * identical to the previous one is dropped right there, so an unchanged
+ * screen costs one memcmp. Changed frames are encoded by a worker thread,
+ * but only while somebody is watching, and only into the formats somebody
+ * is watching, each into a buffer that already holds the multipart headers.
+ * Every client is then sent that same buffer, with the same skip-if-busy
+ * rule scopeviewd uses for its own clients.
+ *
+ * Connection handling runs on the daemon's main loop: it polls the fds
+ * from httpd_pollfds() and hands the results to httpd_dispatch().
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <jpeglib.h>
+#include "decode.h"
+#include "httpd.h"
+#include "palette.h"
+#include "pngwrite.h"
+
+#define HTTP_MAX_CLIENTS (HTTPD_MAX_FDS - 2)
+#define HTTP_REQUEST_MAX 2048
+#define JPEG_QUALITY 90
+#define BOUNDARY "scopeviewframe"
+
+enum { FORMAT_JPEG, FORMAT_PNG, FORMAT_COUNT };
+
+static const char * content_types[FORMAT_COUNT] = {"image/jpeg", "image/png"};
+
+/* one encoded frame, shared by every client sending it */
+struct http_image {
+    int refs;
+    uint8_t * part[FORMAT_COUNT];  /* multipart headers, image, CRLF */
+    size_t part_len[FORMAT_COUNT];
+    size_t data_off[FORMAT_COUNT];  /* where the bare image starts */
+    size_t data_len[FORMAT_COUNT];
+};
+
+enum {
+    HTTP_READING,  /* request not complete yet */
+    HTTP_WAITING,  /* single frame requested, none encoded yet */
+    HTTP_STREAM,
+    HTTP_SINGLE
+};
+
+struct http_client {
+    int fd;
+    int state;
+    int format;
+    char request[HTTP_REQUEST_MAX];
+    size_t request_len;
+    char head[256];  /* response header, sent before any image */
+    size_t head_len;
+    size_t head_off;
+    const char * text;  /* static response body */
+    size_t text_len;
+    size_t text_off;
+    struct http_image * cur;  /* image being sent */
+    size_t off;
+    struct http_image * next;  /* newest image waiting behind cur */
+};
+
+static const char index_html[] =
+    "<!DOCTYPE html>\n<html><head><title>scopeview</title></head>\n"
+    "<body style=\"margin:0;background:#000\">\n"
+    "<img src=\"/stream.mjpeg\" style=\"width:100%;image-rendering:pixelated\">\n"
+    "</body></html>\n";
+
+static const char not_found[] = "not found\n";
+static const char bad_request[] = "bad request\n";
+
+static int listen_fd = -1;
+static const char * unix_path;
+static int theme;
+static struct http_client clients[HTTP_MAX_CLIENTS];
+static int client_count;
+static struct http_image * current;  /* latest encoded image */
+
+/* state shared with the encoder thread */
+static pthread_t encoder;
+static pthread_mutex_t enc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t enc_cond = PTHREAD_COND_INITIALIZER;
+static uint8_t latest[FRAME_PIXELS];
+static int have_latest;
+static int dirty;  /* latest differs from what was last encoded */
+static int watchers[FORMAT_COUNT];  /* clients waiting for images */
+static int stopping;
+static struct http_image * encoded;  /* handed to the main loop */
+static int wake_fd[2];
+
+static void image_unref(struct http_image * img) {
+    int i;
+
+    if (img && --img->refs == 0) {
+	for (i = 0; i < FORMAT_COUNT; i++) {
+	    free(img->part[i]);
+	}
+	free(img);
+    }
+}
+
+static int jpeg_encode_rgb(const uint8_t * rgb, int width, int height,
+			   uint8_t ** out, size_t * length) {
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    unsigned char * mem = NULL;
+    unsigned long mem_len = 0;
+    JSAMPROW row;
+
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &mem, &mem_len);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, JPEG_QUALITY, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+	row = (JSAMPROW) rgb + cinfo.next_scanline * width * 3;
+	jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    *out = mem;
+    *length = mem_len;
+    return mem == NULL;
+}
+
+/* wrap an encoded image in its multipart headers, takes ownership of data */
+static int image_set(struct http_image * img, int format, uint8_t * data,
+		     size_t length) {
+    char head[128];
+    int head_len;
+
+    head_len = snprintf(head, sizeof(head),
+			"--" BOUNDARY "\r\nContent-Type: %s\r\n"
+			"Content-Length: %zu\r\n\r\n",
+			content_types[format], length);
+    img->part[format] = malloc(head_len + length + 2);
+    if (!img->part[format]) {
+	free(data);
+	return 1;
+    }
+    memcpy(img->part[format], head, head_len);
+    memcpy(img->part[format] + head_len, data, length);
+    memcpy(img->part[format] + head_len + length, "\r\n", 2);
+    free(data);
+    img->part_len[format] = head_len + length + 2;
+    img->data_off[format] = head_len;
+    img->data_len[format] = length;
+    return 0;
+}
+
+/* with enc_lock held */
+static int watching_any(void) {
+    return watchers[FORMAT_JPEG] > 0 || watchers[FORMAT_PNG] > 0;
+}
+
+static void * encoder_thread(void * arg) {
+    static uint8_t indexed[FRAME_PIXELS];
+    static uint8_t rgb[FRAME_PIXELS * 3];
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    struct http_image * img, * old;
+    int want[FORMAT_COUNT];
+    uint8_t * data;
+    size_t length;
+    int failed;
+
+    while (1) {
+	pthread_mutex_lock(&enc_lock);
+	while (!stopping && !(dirty && watching_any())) {
+	    pthread_cond_wait(&enc_cond, &enc_lock);
+	}
+	if (stopping) {
+	    pthread_mutex_unlock(&enc_lock);
+	    break;
+	}
+	memcpy(indexed, latest, FRAME_PIXELS);
+	want[FORMAT_JPEG] = watchers[FORMAT_JPEG] > 0;
+	want[FORMAT_PNG] = watchers[FORMAT_PNG] > 0;
+	dirty = 0;
+	pthread_mutex_unlock(&enc_lock);
+
+	if (want[FORMAT_JPEG]) {
+	    palette_apply(indexed, color_themes[theme], rgb, FRAME_PIXELS);
+	}
+	img = calloc(1, sizeof(*img));
+	if (!img) {
+	    continue;
+	}
+	img->refs = 1;
+	failed = 0;
+	if (want[FORMAT_JPEG]) {
+	    failed = jpeg_encode_rgb(rgb, FRAME_WIDTH, FRAME_HEIGHT, &data,
+				     &length)
+		|| image_set(img, FORMAT_JPEG, data, length);
+	}
+	if (want[FORMAT_PNG] && !failed) {
+	    decode_pack(indexed, packed);
+	    failed = png_encode_packed(packed, FRAME_WIDTH, FRAME_HEIGHT,
+				       color_themes[theme], &data, &length)
+		|| image_set(img, FORMAT_PNG, data, length);
+	}
+	if (failed) {
+	    image_unref(img);
+	    continue;
+	}
+
+	pthread_mutex_lock(&enc_lock);
+	old = encoded;
+	encoded = img;
+	pthread_mutex_unlock(&enc_lock);
+	image_unref(old); /* never seen by the main loop */
+	if (write(wake_fd[1], "", 1) < 0) {
+	    /* pipe already full, main loop will wake anyway */
+	}
+    }
+    return NULL;
+}
+
+/* acquisition thread: offer a new frame, unchanged ones are dropped here */
+void httpd_frame(const uint8_t * indexed) {
+    if (listen_fd == -1) {
+	return;
+    }
+    pthread_mutex_lock(&enc_lock);
+    if (!have_latest || memcmp(latest, indexed, FRAME_PIXELS)) {
+	memcpy(latest, indexed, FRAME_PIXELS);
+	have_latest = 1;
+	dirty = 1;
+	if (watching_any()) {
+	    pthread_cond_signal(&enc_cond);
+	}
+    }
+    pthread_mutex_unlock(&enc_lock);
+}
+
+/* main loop: count a client in or out of the watchers of its format */
+static void set_watching(int format, int delta) {
+    pthread_mutex_lock(&enc_lock);
+    watchers[format] += delta;
+    if (delta > 0 && have_latest && !(current && current->part[format])) {
+	/* nothing encoded in this format yet, or in flight without it */
+	dirty = 1;
+    }
+    if (watching_any() && dirty) {
+	pthread_cond_signal(&enc_cond);
+    }
+    pthread_mutex_unlock(&enc_lock);
+}
+
+static int is_watching(const struct http_client * c) {
+    return c->state == HTTP_STREAM || c->state == HTTP_WAITING;
+}
+
+static void client_drop(int i) {
+    if (is_watching(&clients[i])) {
+	set_watching(clients[i].format, -1);
+    }
+    close(clients[i].fd);
+    image_unref(clients[i].cur);
+    image_unref(clients[i].next);
+    clients[i] = clients[--client_count];
+}
+
+static void client_queue(struct http_client * c, struct http_image * img) {
+    img->refs++;
+    if (!c->cur) {
+	c->cur = img;
+	c->off = 0;
+    } else {
+	image_unref(c->next);
+	c->next = img;
+    }
+}
+
+/* send what the socket takes. returns nonzero once the client is done */
+static int client_flush(struct http_client * c) {
+    const uint8_t * data;
+    size_t length;
+    ssize_t n;
+
+    while (1) {
+	if (c->head_off < c->head_len) {
+	    data = (const uint8_t *) c->head + c->head_off;
+	    length = c->head_len - c->head_off;
+	} else if (c->text_off < c->text_len) {
+	    data = (const uint8_t *) c->text + c->text_off;
+	    length = c->text_len - c->text_off;
+	} else if (c->cur && c->state == HTTP_STREAM) {
+	    data = c->cur->part[c->format] + c->off;
+	    length = c->cur->part_len[c->format] - c->off;
+	} else if (c->cur && c->state == HTTP_SINGLE) {
+	    data = c->cur->part[c->format] + c->cur->data_off[c->format]
+		+ c->off;
+	    length = c->cur->data_len[c->format] - c->off;
+	} else {
+	    /* nothing left to send, single responses are complete */
+	    return c->state != HTTP_STREAM && c->state != HTTP_WAITING
+		&& c->state != HTTP_READING;
+	}
+
+	n = send(c->fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return !(errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+	if (c->head_off < c->head_len) {
+	    c->head_off += n;
+	} else if (c->text_off < c->text_len) {
+	    c->text_off += n;
+	} else if ((size_t) n < length) {
+	    c->off += n;
+	} else if (c->state == HTTP_SINGLE) {
+	    image_unref(c->cur);
+	    c->cur = NULL;
+	    return 1;
+	} else {
+	    image_unref(c->cur);
+	    c->cur = c->next;
+	    c->next = NULL;
+	    c->off = 0;
+	}
+    }
+}
+
+static void respond(struct http_client * c, const char * status,
+		    const char * type, const char * body, size_t length) {
+    c->head_len = snprintf(c->head, sizeof(c->head),
+			   "HTTP/1.0 %s\r\nContent-Type: %s\r\n"
+			   "Content-Length: %zu\r\nCache-Control: no-cache\r\n"
+			   "Connection: close\r\n\r\n",
+			   status, type, length);
+    c->head_off = 0;
+    c->text = body;
+    c->text_len = length;
+    c->text_off = 0;
+    c->state = HTTP_SINGLE;
+}
+
+static void respond_image(struct http_client * c) {
+    c->head_len = snprintf(c->head, sizeof(c->head),
+			   "HTTP/1.0 200 OK\r\nContent-Type: %s\r\n"
+			   "Content-Length: %zu\r\nCache-Control: no-cache\r\n"
+			   "Connection: close\r\n\r\n",
+			   content_types[c->format],
+			   current->data_len[c->format]);
+    c->head_off = 0;
+    c->state = HTTP_SINGLE;
+    client_queue(c, current);
+}
+
+static int is_dirty(void) {
+    int rv;
+
+    pthread_mutex_lock(&enc_lock);
+    rv = dirty;
+    pthread_mutex_unlock(&enc_lock);
+    return rv;
+}
+
+/* act on a complete request line */
+static void handle_request(struct http_client * c) {
+    char path[256];
+
+    if (sscanf(c->request, "GET %255s HTTP/", path) != 1) {
+	respond(c, "400 Bad Request", "text/plain", bad_request,
+		sizeof(bad_request) - 1);
+	return;
+    }
+    /* query strings are ignored */
+    path[strcspn(path, "?")] = '\0';
+
+    if (!strcmp(path, "/")) {
+	respond(c, "200 OK", "text/html", index_html, sizeof(index_html) - 1);
+    } else if (!strcmp(path, "/stream.mjpeg") || !strcmp(path, "/stream.png")) {
+	c->format = strstr(path, ".png") ? FORMAT_PNG : FORMAT_JPEG;
+	c->head_len = snprintf(c->head, sizeof(c->head),
+			       "HTTP/1.0 200 OK\r\nContent-Type: "
+			       "multipart/x-mixed-replace;boundary=" BOUNDARY
+			       "\r\nCache-Control: no-cache\r\n"
+			       "Connection: close\r\n\r\n");
+	c->head_off = 0;
+	c->state = HTTP_STREAM;
+	set_watching(c->format, 1);
+	if (current && current->part[c->format]) {
+	    client_queue(c, current); /* something to look at right away */
+	}
+    } else if (!strcmp(path, "/frame.jpg") || !strcmp(path, "/frame.png")) {
+	c->format = strstr(path, ".png") ? FORMAT_PNG : FORMAT_JPEG;
+	if (current && current->part[c->format] && !is_dirty()) {
+	    respond_image(c);
+	} else {
+	    c->state = HTTP_WAITING;
+	    set_watching(c->format, 1);
+	}
+    } else {
+	respond(c, "404 Not Found", "text/plain", not_found,
+		sizeof(not_found) - 1);
+    }
+}
+
+/* read request bytes, returns nonzero if the client should be dropped */
+static int client_read(struct http_client * c) {
+    char scratch[256];
+    ssize_t n;
+
+    if (c->state != HTTP_READING) {
+	/* ignore anything after the request, but notice the close */
+	n = read(c->fd, scratch, sizeof(scratch));
+	return n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR);
+    }
+    n = read(c->fd, c->request + c->request_len,
+	     sizeof(c->request) - 1 - c->request_len);
+    if (n <= 0) {
+	return n == 0 || (errno != EAGAIN && errno != EINTR);
+    }
+    c->request_len += n;
+    c->request[c->request_len] = '\0';
+    if (strstr(c->request, "\r\n\r\n") || strstr(c->request, "\n\n")) {
+	handle_request(c);
+    } else if (c->request_len == sizeof(c->request) - 1) {
+	return 1; /* too long */
+    }
+    return 0;
+}
+
+/* main loop: take over a newly encoded image and pass it on */
+static void deliver_encoded(void) {
+    struct http_image * img;
+    char drain[64];
+    int i;
+
+    while (read(wake_fd[0], drain, sizeof(drain)) > 0) {
+    }
+    pthread_mutex_lock(&enc_lock);
+    img = encoded;
+    encoded = NULL;
+    pthread_mutex_unlock(&enc_lock);
+    if (!img) {
+	return;
+    }
+    image_unref(current);
+    current = img;
+
+    for (i = client_count - 1; i >= 0; i--) {
+	if (!current->part[clients[i].format]) {
+	    continue; /* joined after this one was started */
+	} else if (clients[i].state == HTTP_STREAM) {
+	    client_queue(&clients[i], current);
+	} else if (clients[i].state == HTTP_WAITING) {
+	    set_watching(clients[i].format, -1);
+	    respond_image(&clients[i]);
+	} else {
+	    continue;
+	}
+	if (client_flush(&clients[i])) {
+	    client_drop(i);
+	}
+    }
+}
+
+static void accept_clients(void) {
+    int fd;
+
+    while ((fd = accept(listen_fd, NULL, NULL)) != -1) {
+	if (client_count == HTTP_MAX_CLIENTS) {
+	    close(fd);
+	    continue;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	memset(&clients[client_count], 0, sizeof(struct http_client));
+	clients[client_count].fd = fd;
+	clients[client_count++].state = HTTP_READING;
+    }
+}
+
+/* fill in the fds the main loop should poll, returns how many */
+int httpd_pollfds(struct pollfd * fds) {
+    int i;
+
+    if (listen_fd == -1) {
+	return 0;
+    }
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_fd[0];
+    fds[1].events = POLLIN;
+    for (i = 0; i < client_count; i++) {
+	fds[i + 2].fd = clients[i].fd;
+	fds[i + 2].events = POLLIN;
+	if (clients[i].head_off < clients[i].head_len
+	    || clients[i].text_off < clients[i].text_len || clients[i].cur) {
+	    fds[i + 2].events |= POLLOUT;
+	}
+    }
+    return client_count + 2;
+}
+
+void httpd_dispatch(const struct pollfd * fds, int count) {
+    int i;
+
+    if (count == 0) {
+	return;
+    }
+    for (i = count - 3; i >= 0; i--) {
+	if (fds[i + 2].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+	    client_drop(i);
+	} else if (fds[i + 2].revents & POLLIN && client_read(&clients[i])) {
+	    client_drop(i);
+	} else if (client_flush(&clients[i])) {
+	    client_drop(i);
+	}
+    }
+    if (fds[1].revents & POLLIN) {
+	deliver_encoded();
+    }
+    if (fds[0].revents & POLLIN) {
+	accept_clients();
+    }
+}
+
+/*
+ * start serving on addr, either a port number (bound to 127.0.0.1 only) or
+ * the path of a Unix socket. returns 0 on success.
+ */
+int httpd_init(const char * addr, int theme_index) {
+    struct sockaddr_un sun;
+    struct sockaddr_in sin;
+    struct stat st;
+    char * end;
+    long port;
+    int one = 1;
+
+    theme = theme_index;
+    port = strtol(addr, &end, 10);
+    if (*end == '\0' && port > 0 && port < 65536) {
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd == -1) {
+	    return 1;
+	}
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(listen_fd, (struct sockaddr *) &sin, sizeof(sin))) {
+	    close(listen_fd);
+	    listen_fd = -1;
+	    return 1;
+	}
+    } else {
+	if (strlen(addr) >= sizeof(sun.sun_path)) {
+	    return 1;
+	}
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strcpy(sun.sun_path, addr);
+	if (!stat(addr, &st) && S_ISSOCK(st.st_mode)) {
+	    unlink(addr);
+	}
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd == -1) {
+	    return 1;
+	}
+	if (bind(listen_fd, (struct sockaddr *) &sun, sizeof(sun))) {
+	    close(listen_fd);
+	    listen_fd = -1;
+	    return 1;
+	}
+	unix_path = addr;
+    }
+    if (listen(listen_fd, 16) || pipe(wake_fd)) {
+	close(listen_fd);
+	listen_fd = -1;
+	return 1;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(wake_fd[0], F_SETFL, fcntl(wake_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_fd[1], F_SETFL, fcntl(wake_fd[1], F_GETFL) | O_NONBLOCK);
+
+    if (pthread_create(&encoder, NULL, encoder_thread, NULL)) {
+	close(listen_fd);
+	listen_fd = -1;
+	return 1;
+    }
+    return 0;
+}
+
+void httpd_shutdown(void) {
+    int i;
+
+    if (listen_fd == -1) {
+	return;
+    }
+    pthread_mutex_lock(&enc_lock);
+    stopping = 1;
+    pthread_cond_signal(&enc_cond);
+    pthread_mutex_unlock(&enc_lock);
+    pthread_join(encoder, NULL);
+
+    for (i = client_count - 1; i >= 0; i--) {
+	client_drop(i);
+    }
+    image_unref(encoded);
+    image_unref(current);
+    close(listen_fd);
+    close(wake_fd[0]);
+    close(wake_fd[1]);
+    listen_fd = -1;
+    if (unix_path) {
+	unlink(unix_path);
+    }
+}
@@ -0,0 +1,19 @@
+/*
+ * About : Optional HTTP server streaming the live view, see httpd.c.
+ */
+
+#ifndef HTTPD_H
+#define HTTPD_H
+
+#include <poll.h>
+#include <stdint.h>
+
+#define HTTPD_MAX_FDS 34  /* pollfds httpd_pollfds() may fill in */
+
+int httpd_init(const char * addr, int theme);
+void httpd_frame(const uint8_t * indexed);
+int httpd_pollfds(struct pollfd * fds);
+void httpd_dispatch(const struct pollfd * fds, int count);
+void httpd_shutdown(void);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+ * About : Ways of turning a screen dump into RGB, see kernels.h.
+ */
+
+#include <string.h>
+#include "decode.h"
+#include "kernels.h"
+#include "model.h"
+
+#define TILE_ROWS 8  /* dump bytes per raster per tile, 16 output rows */
+
+/* the viewer's loop before the library, verbatim but for its globals */
+static void kernel_original(const uint8_t * buffer, const palette_lut * lut,
+			    const rgb_color * colors, uint8_t * scope_pixels) {
+    int byte_cnt, row, col;
+    unsigned char in_byte;
+
+    /* unpack input buffer data to output buffer */
+    for(byte_cnt=0; byte_cnt<SCREEN_DUMP_SIZE; byte_cnt++)
+	{
+	    in_byte = buffer[byte_cnt];
+
+	    /* set up to save output data rotated by 90 degrees */
+	    row = byte_cnt%128;
+	    col = (INPUT_WIDTH-1)-byte_cnt/128;
+	    if(byte_cnt%128 < 120) // skip the last 8 rows of the image
+		{
+		    /* save pixel 1 of this input byte */
+		    scope_pixels[(320*3*(row*2))+(3*col)] =
+			colors[((in_byte >> 4) & 0x0f)].r;
+		    scope_pixels[(320*3*(row*2))+(3*col)+1] =
+			colors[((in_byte >> 4) & 0x0f)].g;
+		    scope_pixels[(320*3*(row*2))+(3*col)+2] =
+			colors[((in_byte >> 4) & 0x0f)].b;
+		    /* save pixel 2 of this input byte */
+		    scope_pixels[(320*3*(row*2+1))+(3*col)] =
+			colors[(in_byte & 0x0f)].r;
+		    scope_pixels[(320*3*(row*2+1))+(3*col)+1] =
+			colors[(in_byte & 0x0f)].g;
+		    scope_pixels[(320*3*(row*2+1))+(3*col)+2] =
+			colors[(in_byte & 0x0f)].b;
+		}
+	}
+}
+
+/* what the viewer does now: decode to indices, then look up colors */
+static void kernel_library(const uint8_t * dump, const palette_lut * lut,
+			   const rgb_color * colors, uint8_t * rgb) {
+    static uint8_t indexed[FRAME_PIXELS];
+
+    decode_indexed(dump, indexed);
+    palette_lut_indexed(lut, indexed, rgb, FRAME_PIXELS);
+}
+
+/* the decoder model.c generates from the GDS-820C layout */
+static void kernel_model(const uint8_t * dump, const palette_lut * lut,
+			 const rgb_color * colors, uint8_t * rgb) {
+    static uint8_t indexed[FRAME_PIXELS];
+
+    scope_models[MODEL_GDS820C].decode(dump, indexed);
+    palette_lut_indexed(lut, indexed, rgb, FRAME_PIXELS);
+}
+
+/* one lookup per dump byte, for both of its pixels */
+static void kernel_pair_lut(const uint8_t * dump, const palette_lut * lut,
+			    const rgb_color * colors, uint8_t * rgb) {
+    const uint8_t * pair;
+    uint8_t * out;
+    int raster, row;
+
+    for (raster = 0; raster < INPUT_WIDTH; raster++) {
+	out = rgb + 3 * (INPUT_WIDTH - 1 - raster);
+	for (row = 0; row < RASTER_USED; row++) {
+	    pair = lut->rgb_pair[dump[raster * RASTER_PITCH + row]];
+	    memcpy(out, pair, 3);
+	    memcpy(out + FRAME_WIDTH * 3, pair + 3, 3);
+	    out += 2 * FRAME_WIDTH * 3;
+	}
+    }
+}
+
+/*
+ * walk the output in bands of 2*TILE_ROWS rows, left to right, so writes
+ * go out in order and each raster's bytes for a band are read together
+ */
+static void kernel_tiled(const uint8_t * dump, const palette_lut * lut,
+			 const rgb_color * colors, uint8_t * rgb) {
+    const uint8_t * in, * pair;
+    uint8_t * out;
+    int band, col, i;
+
+    for (band = 0; band < RASTER_USED; band += TILE_ROWS) {
+	for (col = 0; col < FRAME_WIDTH; col++) {
+	    in = dump + (INPUT_WIDTH - 1 - col) * RASTER_PITCH + band;
+	    out = rgb + (2 * band * FRAME_WIDTH + col) * 3;
+	    for (i = 0; i < TILE_ROWS; i++) {
+		pair = lut->rgb_pair[in[i]];
+		memcpy(out, pair, 3);
+		memcpy(out + FRAME_WIDTH * 3, pair + 3, 3);
+		out += 2 * FRAME_WIDTH * 3;
+	    }
+	}
+    }
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/* four rounds of interleaving; row i ends up holding column reverse4(i) */
+static void transpose16(__m128i * x) {
+    __m128i y[16];
+    int i, round;
+
+    for (round = 0; round < 4; round++) {
+	for (i = 0; i < 8; i++) {
+	    switch (round) {
+	    case 0:
+		y[i] = _mm_unpacklo_epi8(x[2 * i], x[2 * i + 1]);
+		y[i + 8] = _mm_unpackhi_epi8(x[2 * i], x[2 * i + 1]);
+		break;
+	    case 1:
+		y[i] = _mm_unpacklo_epi16(x[2 * i], x[2 * i + 1]);
+		y[i + 8] = _mm_unpackhi_epi16(x[2 * i], x[2 * i + 1]);
+		break;
+	    case 2:
+		y[i] = _mm_unpacklo_epi32(x[2 * i], x[2 * i + 1]);
+		y[i + 8] = _mm_unpackhi_epi32(x[2 * i], x[2 * i + 1]);
+		break;
+	    default:
+		y[i] = _mm_unpacklo_epi64(x[2 * i], x[2 * i + 1]);
+		y[i + 8] = _mm_unpackhi_epi64(x[2 * i], x[2 * i + 1]);
+		break;
+	    }
+	}
+	memcpy(x, y, sizeof(y));
+    }
+}
+
+/*
+ * rotate 16x16 byte blocks with SSE2 transposes, rasters loaded last to
+ * first so columns come out left to right, then split the nibbles
+ */
+static void decode_indexed_sse2(const uint8_t * dump, uint8_t * indexed) {
+    static const int reverse4[16] =
+	{0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15};
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i x[16], v;
+    int raster, byte, col, i, b;
+
+    for (raster = 0; raster < INPUT_WIDTH; raster += 16) {
+	col = INPUT_WIDTH - 16 - raster;
+	for (byte = 0; byte < RASTER_USED; byte += 16) {
+	    for (i = 0; i < 16; i++) {
+		x[i] = _mm_loadu_si128((const __m128i *)
+				       (dump + (raster + 15 - i) * RASTER_PITCH
+					+ byte));
+	    }
+	    transpose16(x);
+	    for (i = 0; i < 16; i++) {
+		b = byte + reverse4[i];
+		if (b >= RASTER_USED) {
+		    continue;
+		}
+		v = x[i];
+		_mm_storeu_si128((__m128i *) (indexed + 2 * b * FRAME_WIDTH
+					      + col),
+				 _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		_mm_storeu_si128((__m128i *) (indexed + (2 * b + 1)
+					      * FRAME_WIDTH + col),
+				 _mm_and_si128(v, mask));
+	    }
+	}
+    }
+}
+
+static void kernel_sse2(const uint8_t * dump, const palette_lut * lut,
+			const rgb_color * colors, uint8_t * rgb) {
+    static uint8_t indexed[FRAME_PIXELS];
+
+    decode_indexed_sse2(dump, indexed);
+    palette_lut_indexed(lut, indexed, rgb, FRAME_PIXELS);
+}
+#endif
+
+const struct dump_kernel kernels[] = {
+    {"original", kernel_original},
+    {"library", kernel_library},
+    {"model", kernel_model},
+    {"pair-lut", kernel_pair_lut},
+    {"tiled", kernel_tiled},
+#ifdef __SSE2__
+    {"sse2", kernel_sse2},
+#endif
+};
+const int kernel_count = sizeof(kernels) / sizeof(kernels[0]);
@@ -0,0 +1,31 @@
+/*
+ * About : Ways of turning a screen dump into RGB, for the benchmarks and the
+ *         golden tests.
+ *
+ * Notes :
+ *
+ * Every kernel takes a screen dump and writes the 320x240 RGB picture in the
+ * given theme, passed both as a compiled palette_lut and as plain colors.
+ * "original" is the loop the viewer used to run in redraw_timer_handler(),
+ * kept as it was: it defines the right answer, and every other kernel must
+ * match it bit for bit (make check) before it may be used anywhere.
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+#include "palette.h"
+
+typedef void (*dump_kernel_fn)(const uint8_t * dump, const palette_lut * lut,
+			       const rgb_color * colors, uint8_t * rgb);
+
+struct dump_kernel {
+    const char * name;
+    dump_kernel_fn run;
+};
+
+extern const struct dump_kernel kernels[];
+extern const int kernel_count;
+
+#endif
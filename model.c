@@ -0,0 +1,75 @@
+/*
+ * About : Screen dump layouts and their decoders, see model.h.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include "model.h"
+
+/*
+ * the general loop. it is only ever inlined with constant arguments, so
+ * each model gets its own copy with the layout folded in.
+ */
+static inline __attribute__ ((always_inline))
+void decode_layout(const uint8_t * dump, uint8_t * indexed, int width,
+		   int height, int pitch, int bits, int vertical) {
+    const int per_byte = 8 / bits, mask = (1 << bits) - 1;
+    const int rasters = vertical ? width : height;
+    const int used = (vertical ? height : width) / per_byte;
+    const uint8_t * in;
+    uint8_t * out;
+    int raster, i, k;
+
+    for (raster = 0; raster < rasters; raster++) {
+	in = dump + raster * pitch;
+	out = vertical ? indexed + (width - 1 - raster)
+	    : indexed + raster * FRAME_WIDTH;
+	for (i = 0; i < used; i++) {
+	    for (k = 0; k < per_byte; k++) {
+		*out = in[i] >> (8 - bits * (k + 1)) & mask;
+		out += vertical ? FRAME_WIDTH : 1;
+	    }
+	}
+    }
+}
+
+#define MODEL_DECODER(id, name, w, h, pitch, bits, vertical, request)	\
+    _Static_assert(w == FRAME_WIDTH && h == FRAME_HEIGHT,		\
+		   name " must fill a frame");				\
+    _Static_assert((vertical ? w : h) * pitch <= MODEL_DUMP_MAX,	\
+		   name " dump is too big");				\
+    static void decode_##id(const uint8_t * dump, uint8_t * indexed) {	\
+	decode_layout(dump, indexed, w, h, pitch, bits, vertical);	\
+    }
+MODEL_LIST(MODEL_DECODER)
+
+#define MODEL_ENTRY(id, name, w, h, pitch, bits, vertical, request)	\
+    [MODEL_##id] = {name, w, h, pitch, (vertical ? h : w) * bits / 8, bits, \
+		    vertical, (vertical ? w : h) * pitch,		\
+		    (const uint8_t *) request, sizeof(request) - 1, decode_##id},
+const scope_model scope_models[MODEL_COUNT] = { MODEL_LIST(MODEL_ENTRY) };
+
+/* by name, with or without the "GDS-" */
+const scope_model * model_find(const char * name) {
+    int i;
+
+    for (i = 0; i < MODEL_COUNT; i++) {
+	if (!strcasecmp(name, scope_models[i].name)
+	    || !strcasecmp(name, scope_models[i].name + 4)) {
+	    return &scope_models[i];
+	}
+    }
+    return NULL;
+}
+
+/* from an *IDN? reply, e.g. "GW,GDS-820C,...", NULL if none matches */
+const scope_model * model_identify(const char * idn) {
+    int i;
+
+    for (i = 0; i < MODEL_COUNT; i++) {
+	if (strstr(idn, scope_models[i].name)) {
+	    return &scope_models[i];
+	}
+    }
+    return NULL;
+}
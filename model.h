@@ -0,0 +1,62 @@
+/*
+ * About : Screen dump layouts of the scopes we can talk to.
+ *
+ * Notes :
+ *
+ * Each model sends its screen as rasters of a fixed pitch, of which the
+ * first bytes hold pixels at some bits per pixel and the rest is padding.
+ * Rasters run either vertically, one per column from the right edge (as on
+ * the GDS-820C, see decode.h), or horizontally, one per row from the top.
+ *
+ * MODEL_LIST() is the one place a layout is written down. model.c expands
+ * it into a decoder per model with the layout as constants, so every inner
+ * loop has fixed strides and shifts, and into the scope_models[] table.
+ *
+ * Only the GDS-820C layout has been checked against a real scope. The
+ * GDS-810C and GDS-840C are the same instrument with other front ends and
+ * are assumed to send the same screen. Everything downstream works on
+ * FRAME_WIDTH x FRAME_HEIGHT frames, so a model has to fill one exactly.
+ */
+
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decode.h"
+
+#define MODEL_DUMP_MAX SCREEN_DUMP_SIZE  /* largest screen dump of any model */
+
+/*   id       name        width height pitch bits vertical request */
+#define MODEL_LIST(M)							\
+    M(GDS810C, "GDS-810C", 320, 240, 128, 4, 1, "\x57\x00\x00\x0a")	\
+    M(GDS820C, "GDS-820C", 320, 240, 128, 4, 1, "\x57\x00\x00\x0a")	\
+    M(GDS840C, "GDS-840C", 320, 240, 128, 4, 1, "\x57\x00\x00\x0a")
+
+#define MODEL_ENUM(id, name, w, h, pitch, bits, vertical, request) MODEL_##id,
+enum { MODEL_LIST(MODEL_ENUM) MODEL_COUNT };
+#undef MODEL_ENUM
+
+#define MODEL_DEFAULT MODEL_GDS820C
+
+typedef void (*model_decode_fn)(const uint8_t * dump, uint8_t * indexed);
+
+typedef struct {
+    const char * name;  /* as in the *IDN? reply */
+    int width, height;  /* visible pixels */
+    int pitch;  /* bytes per raster as sent */
+    int used;  /* bytes of each raster holding pixels */
+    int bits;  /* per pixel, high bits first */
+    int vertical;  /* rasters are columns, right to left */
+    size_t dump_size;
+    const uint8_t * request;  /* asks for a screen dump */
+    size_t request_length;
+    model_decode_fn decode;  /* dump to an indexed frame */
+} scope_model;
+
+extern const scope_model scope_models[MODEL_COUNT];
+
+const scope_model * model_find(const char * name);
+const scope_model * model_identify(const char * idn);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * About : A stored reference frame shown under the live one, see overlay.h.
+ */
+
+#include "overlay.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* color indices of traces, and of what they are drawn over (palette.c) */
+static const uint8_t is_trace[16] = {[2] = 1, [4] = 1, [14] = 1};
+static const uint8_t is_backdrop[16] = {[1] = 1, [8] = 1};
+
+void overlay_palette_init(overlay_palette * p, const rgb_color * colors,
+			  int mode) {
+    static const uint8_t color[3] = {OVERLAY_COLOR};
+    int ref, live, c;
+    uint8_t r[3], l[3];
+
+    for (ref = 0; ref < 16; ref++) {
+	for (live = 0; live < 16; live++) {
+	    l[0] = colors[live].r;
+	    l[1] = colors[live].g;
+	    l[2] = colors[live].b;
+	    r[0] = colors[ref].r;
+	    r[1] = colors[ref].g;
+	    r[2] = colors[ref].b;
+	    for (c = 0; c < 3; c++) {
+		if (!is_trace[ref] || !is_backdrop[live]) {
+		    p->rgb[ref << 4 | live][c] = l[c];
+		} else if (mode == OVERLAY_COLORED) {
+		    p->rgb[ref << 4 | live][c] = color[c];
+		} else {
+		    p->rgb[ref << 4 | live][c] = (r[c] * OVERLAY_MIX
+						  + l[c] * (100 - OVERLAY_MIX)
+						  + 50) / 100;
+		}
+	    }
+	}
+    }
+}
+
+/* composite[i] = reference[i] << 4 | live[i], for 4 bit indices */
+void overlay_compose(const uint8_t * live, const uint8_t * reference,
+		     uint8_t * composite, int count) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i high = _mm_set1_epi8((char) 0xf0);
+    __m128i l, r;
+
+    for (; i + 16 <= count; i += 16) {
+	l = _mm_loadu_si128((const __m128i *) (live + i));
+	r = _mm_loadu_si128((const __m128i *) (reference + i));
+	r = _mm_and_si128(_mm_slli_epi16(r, 4), high);
+	_mm_storeu_si128((__m128i *) (composite + i), _mm_or_si128(r, l));
+    }
+#endif
+    for (; i < count; i++) {
+	composite[i] = reference[i] << 4 | live[i];
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * About : A stored reference frame shown under the live one.
+ *
+ * Notes :
+ *
+ * overlay_compose() packs each live pixel's color index together with the
+ * reference frame's at the same spot, reference in the high nibble, into a
+ * composite frame. An overlay_palette maps all 256 pairs to RGB: the live
+ * color wherever the live screen has something to show, and the reference
+ * trace, faded into the live color or in one color of its own, where the
+ * live screen shows only background or graticule. Drawing the composite
+ * frame with that palette is then the same single lookup per pixel as
+ * drawing a plain frame, and the live traces always stay on top.
+ */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+#include "palette.h"
+
+#define OVERLAY_FADED 0  /* reference traces mixed into the background */
+#define OVERLAY_COLORED 1  /* reference traces all in OVERLAY_COLOR */
+#define OVERLAY_MODES 2
+#define OVERLAY_MIX 40  /* percent of the reference color when faded */
+#define OVERLAY_COLOR 0xff, 0x40, 0xff
+
+typedef struct {
+    uint8_t rgb[256][3];  /* reference << 4 | live -> RGB */
+} overlay_palette;
+
+void overlay_palette_init(overlay_palette * p, const rgb_color * colors,
+			  int mode);
+void overlay_compose(const uint8_t * live, const uint8_t * reference,
+		     uint8_t * composite, int count);
+
+#endif
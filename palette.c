@@ -0,0 +1,301 @@
+/*
+ * About : Color themes for the 16 color indices the scope uses.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "palette.h"
+
+#define PALETTE_NAME 32
+
+/* Original colors from LCD display */
+rgb_color colors_orig[] = {
+    {0x00, 0x00, 0x00},  /* Menu text                        */
+    {0x00, 0x00, 0x00},  /* Trace background                 */
+    {0xff, 0xff, 0x00},  /* Channel-1 trace/info             */
+    {0x80, 0x80, 0x80},  /* Unknown                          */
+    {0x00, 0xff, 0xff},  /* Channel-2 trace/info             */
+    {0x80, 0x80, 0x80},  /* Unknown                          */
+    {0x66, 0xff, 0x66},  /* Horiz./trigger info/markers      */
+    {0xff, 0xff, 0xff},  /* GUI text and borders             */
+    {0x88, 0x88, 0x88},  /* Trace reticle, menu shadow       */
+    {0x80, 0x80, 0x80},  /* Unknown                          */
+    {0x00, 0x00, 0x55},  /* GUI background                   */
+    {0xbb, 0xbb, 0xbb},  /* Menu background                  */
+    {0x80, 0x80, 0x80},  /* Unknown                          */
+    {0x80, 0x80, 0x80},  /* Unknown                          */
+    {0xff, 0x22, 0x22},  /* Math trace/info, logo background */
+    {0xff, 0xff, 0xff}}; /* Menu highlight                   */
+
+/* Happy colors with a white background */
+rgb_color colors_light[] = {
+    {0x55, 0x56, 0x50},  /* Menu text                        */
+    {0xf9, 0xf8, 0xf5},  /* Trace background                 */
+    {0xf9, 0x26, 0x72},  /* Channel-1 trace/info             */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x46, 0xa9, 0xdf},  /* Channel-2 trace/info             */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x86, 0xd2, 0x1e},  /* Horiz./trigger info/markers      */
+    {0x55, 0x56, 0x50},  /* GUI text and borders             */
+    {0xa5, 0xa1, 0xae},  /* Trace reticle, menu shadow       */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0xf8, 0xf8, 0xf2},  /* GUI background                   */
+    {0xf8, 0xf8, 0xf2},  /* Menu background                  */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0xf4, 0xbf, 0x35},  /* Math trace/info, logo background */
+    {0xf9, 0xf8, 0xf5}}; /* Menu highlight                   */
+
+/* Darker colors based on https://github.com/morhetz/gruvbox-generalized */
+rgb_color colors_dark[] = {
+    {0x1d, 0x1c, 0x1a},  /* Menu text                        */
+    {0x1d, 0x1c, 0x1a},  /* Trace background                 */
+    {0xd7, 0x99, 0x21},  /* Channel-1 trace/info             */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x45, 0x85, 0x88},  /* Channel-2 trace/info             */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0xb8, 0xbb, 0x26},  /* Horiz./trigger info/markers      */
+    {0xa8, 0x99, 0x84},  /* GUI text and borders             */
+    {0x92, 0x83, 0x74},  /* Trace reticle, menu shadow       */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x32, 0x30, 0x2f},  /* GUI background                   */
+    {0xa8, 0x99, 0x84},  /* Menu background                  */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0x80, 0x00, 0x80},  /* Unknown                          */
+    {0xfb, 0x49, 0x34},  /* Math trace/info, logo background */
+    {0xeb, 0xdb, 0xb2}}; /* Menu highlight                   */
+
+/* Black and white, for printing */
+rgb_color colors_mono[] = {
+    {0x00, 0x00, 0x00},  /* Menu text                        */
+    {0xff, 0xff, 0xff},  /* Trace background                 */
+    {0x00, 0x00, 0x00},  /* Channel-1 trace/info             */
+    {0xff, 0xff, 0xff},  /* Unknown                          */
+    {0x00, 0x00, 0x00},  /* Channel-2 trace/info             */
+    {0xff, 0xff, 0xff},  /* Unknown                          */
+    {0x00, 0x00, 0x00},  /* Horiz./trigger info/markers      */
+    {0x00, 0x00, 0x00},  /* GUI text and borders             */
+    {0x00, 0x00, 0x00},  /* Trace reticle, menu shadow       */
+    {0xff, 0xff, 0xff},  /* Unknown                          */
+    {0xff, 0xff, 0xff},  /* GUI background                   */
+    {0xff, 0xff, 0xff},  /* Menu background                  */
+    {0xff, 0xff, 0xff},  /* Unknown                          */
+    {0xff, 0xff, 0xff},  /* Unknown                          */
+    {0x00, 0x00, 0x00},  /* Math trace/info, logo background */
+    {0xff, 0xff, 0xff}}; /* Menu highlight                   */
+
+rgb_color *color_themes[PALETTE_MAX] = {colors_dark, colors_light, colors_mono,
+					colors_orig};
+const char *theme_names[PALETTE_MAX] = {"dark", "light", "mono", "orig"};
+int theme_count = COLOR_THEME_COUNT;
+
+/* themes from palette files */
+static rgb_color loaded_colors[PALETTE_MAX - COLOR_THEME_COUNT][16];
+static char loaded_names[PALETTE_MAX - COLOR_THEME_COUNT][PALETTE_NAME];
+
+/* what palette files may call the color indices, see colors_orig */
+static const struct {
+    const char * name;
+    int index;
+} index_names[] = {
+    {"menu-text", 0}, {"background", 1}, {"ch1", 2}, {"ch2", 4},
+    {"trigger", 6}, {"text", 7}, {"grid", 8}, {"gui-bg", 10},
+    {"menu-bg", 11}, {"math", 14}, {"highlight", 15}};
+
+/* look up a theme by name, returns -1 if there is no such theme */
+int palette_find(const char * name) {
+    int i;
+
+    for (i = 0; i < theme_count; i++) {
+	if (!strcmp(name, theme_names[i])) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+static int parse_index(const char * s) {
+    unsigned i;
+    int n;
+
+    if (sscanf(s, "%u%n", &i, &n) == 1 && !s[n]) {
+	return i < 16 ? (int) i : -1;
+    }
+    for (i = 0; i < sizeof(index_names) / sizeof(index_names[0]); i++) {
+	if (!strcmp(s, index_names[i].name)) {
+	    return index_names[i].index;
+	}
+    }
+    return -1;
+}
+
+static int parse_color(const char * s, rgb_color * c) {
+    unsigned r, g, b;
+    int n;
+
+    if (strlen(s) != 7 || sscanf(s, "#%2x%2x%2x%n", &r, &g, &b, &n) != 3
+	|| n != 7) {
+	return 1;
+    }
+    c->r = r;
+    c->g = g;
+    c->b = b;
+    return 0;
+}
+
+/*
+ * read a palette file (see palette.h) and add it to the themes. returns the
+ * new theme or a negative PALETTE_E... code, with *line the last line read.
+ * not thread safe: call it before other threads use the themes.
+ */
+int palette_load(const char * path, int * line) {
+    char text[256], word[PALETTE_NAME], value[PALETTE_NAME], extra[2];
+    char name[PALETTE_NAME], * hash;
+    const char * base;
+    rgb_color colors[16];
+    int hidden[16] = {0};
+    int n = theme_count - COLOR_THEME_COUNT, i, t, count;
+    FILE * f;
+
+    *line = 0;
+    if (theme_count == PALETTE_MAX || !(f = fopen(path, "r"))) {
+	return PALETTE_EREAD;
+    }
+    base = strrchr(path, '/');
+    snprintf(name, sizeof(name), "%s", base ? base + 1 : path);
+    if ((hash = strrchr(name, '.')) && hash != name) {
+	*hash = 0;
+    }
+    memcpy(colors, colors_orig, sizeof(colors));
+
+    while (fgets(text, sizeof(text), f)) {
+	++*line;
+	for (hash = text; (hash = strchr(hash, '#')); hash++) {
+	    if (!hash[1] || !strchr("0123456789abcdefABCDEF", hash[1])) {
+		*hash = 0; /* a comment, not a color */
+		break;
+	    }
+	}
+	count = sscanf(text, "%31s %31s %1s", word, value, extra);
+	if (count <= 0) {
+	    continue;
+	}
+	if (count != 2) {
+	    break;
+	}
+	if (!strcmp(word, "name")) {
+	    strcpy(name, value);
+	} else if (!strcmp(word, "base")) {
+	    if ((t = palette_find(value)) < 0) {
+		break;
+	    }
+	    memcpy(colors, color_themes[t], sizeof(colors));
+	} else if ((i = parse_index(word)) < 0) {
+	    break;
+	} else if (!strcmp(value, "hide")) {
+	    hidden[i] = 1;
+	} else if (parse_color(value, &colors[i])) {
+	    break;
+	} else {
+	    hidden[i] = 0;
+	}
+    }
+    count = ferror(f) ? PALETTE_EREAD : feof(f) ? 0 : PALETTE_ELINE;
+    fclose(f);
+    if (count) {
+	return count;
+    }
+    if (palette_find(name) >= 0) {
+	return PALETTE_ENAME;
+    }
+
+    for (i = 0; i < 16; i++) {
+	loaded_colors[n][i] = hidden[i] ? colors[1] : colors[i];
+    }
+    strcpy(loaded_names[n], name);
+    color_themes[theme_count] = loaded_colors[n];
+    theme_names[theme_count] = loaded_names[n];
+    return theme_count++;
+}
+
+/*
+ * a theme by name, or else a palette file to load. returns the theme, or
+ * -1 after saying what was wrong.
+ */
+int palette_select(const char * name) {
+    int t, line;
+
+    t = palette_find(name);
+    if (t >= 0) {
+	return t;
+    }
+    if (!strchr(name, '/') && !strchr(name, '.')) {
+	printf("no theme called %s\n", name);
+	return -1;
+    }
+    switch (t = palette_load(name, &line)) {
+    case PALETTE_EREAD:
+	printf("error loading palette %s\n", name);
+	return -1;
+    case PALETTE_ELINE:
+	printf("%s:%d: bad palette line\n", name, line);
+	return -1;
+    case PALETTE_ENAME:
+	printf("%s: there is a theme by that name already\n", name);
+	return -1;
+    }
+    return t;
+}
+
+/* convert count indexed pixels to packed 24 bit RGB */
+void palette_apply(const uint8_t * indexed, const rgb_color * colors,
+		   uint8_t * rgb, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+	rgb[3*i] = colors[indexed[i]].r;
+	rgb[3*i+1] = colors[indexed[i]].g;
+	rgb[3*i+2] = colors[indexed[i]].b;
+    }
+}
+
+void palette_lut_init(palette_lut * lut, const rgb_color * colors) {
+    int i, r, g, b;
+
+    for (i = 0; i < 16; i++) {
+	r = colors[i].r;
+	g = colors[i].g;
+	b = colors[i].b;
+	lut->rgb[i][0] = r;
+	lut->rgb[i][1] = g;
+	lut->rgb[i][2] = b;
+	/* BT.601, rounded, 16-235 luma and 16-240 chroma */
+	lut->y[i] = (66 * r + 129 * g + 25 * b + 128 + 16 * 256) >> 8;
+	lut->cb[i] = (-38 * r - 74 * g + 112 * b + 128 + 128 * 256) >> 8;
+	lut->cr[i] = (112 * r - 94 * g - 18 * b + 128 + 128 * 256) >> 8;
+    }
+    for (i = 0; i < 256; i++) {
+	memcpy(lut->rgb_pair[i], lut->rgb[i >> 4], 3);
+	memcpy(lut->rgb_pair[i] + 3, lut->rgb[i & 0x0f], 3);
+    }
+}
+
+/* convert length bytes of packed pixels (two per byte) to 24 bit RGB */
+void palette_lut_packed(const palette_lut * lut, const uint8_t * packed,
+			uint8_t * rgb, int length) {
+    int i;
+
+    for (i = 0; i < length; i++) {
+	memcpy(rgb + 6 * i, lut->rgb_pair[packed[i]], 6);
+    }
+}
+
+/* convert count indexed pixels to 24 bit RGB */
+void palette_lut_indexed(const palette_lut * lut, const uint8_t * indexed,
+			 uint8_t * rgb, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+	memcpy(rgb + 3 * i, lut->rgb[indexed[i]], 3);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * About : Color themes for the 16 color indices the scope uses.
+ *
+ * Notes :
+ *
+ * Besides the COLOR_THEME_COUNT built in themes, up to PALETTE_MAX in all
+ * can be loaded from files with palette_load(). A palette file is lines of
+ *
+ *     name NAME          what to call it (default: the file name)
+ *     base THEME         start from another theme's colors (default: orig)
+ *     INDEX #rrggbb      give one color index a color
+ *     INDEX hide         paint it like the trace background
+ *
+ * where INDEX is 0-15 or one of the names in palette.c (ch1, ch2, menu-bg,
+ * ...). A # not followed by a hex digit starts a comment. Loaded themes are
+ * added to color_themes[] and theme_names[], so they are compiled into a
+ * palette_lut like any other and choosing one costs nothing per frame.
+ *
+ * Those tables are process wide and palette_load() changes them without any
+ * locking, so load every palette at startup, before any other thread looks
+ * at the themes.
+ */
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+
+typedef struct {
+    unsigned char r, g, b;
+} rgb_color;
+
+#define COLOR_THEME_COUNT 4  /* built in */
+#define PALETTE_MAX 16  /* built in and loaded */
+extern rgb_color *color_themes[PALETTE_MAX];
+extern const char *theme_names[PALETTE_MAX];
+extern int theme_count;
+
+/* lookup tables compiled from one theme, see palette_lut_init() */
+typedef struct {
+    uint8_t rgb[16][3];  /* color index -> RGB */
+    uint8_t rgb_pair[256][6];  /* packed byte -> its two pixels as RGB */
+    uint8_t y[16], cb[16], cr[16];  /* color index -> BT.601 studio swing */
+} palette_lut;
+
+int palette_find(const char * name);
+#define PALETTE_EREAD -1  /* palette_load(): can't read it, or no room */
+#define PALETTE_ELINE -2  /* a bad line, see *line */
+#define PALETTE_ENAME -3  /* there is a theme by that name already */
+
+int palette_load(const char * path, int * line);
+int palette_select(const char * name);
+void palette_lut_init(palette_lut * lut, const rgb_color * colors);
+void palette_lut_packed(const palette_lut * lut, const uint8_t * packed,
+			uint8_t * rgb, int length);
+void palette_lut_indexed(const palette_lut * lut, const uint8_t * indexed,
+			 uint8_t * rgb, int count);
+void palette_apply(const uint8_t * indexed, const rgb_color * colors,
+		   uint8_t * rgb, int count);
+
+#endif
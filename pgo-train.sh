@@ -0,0 +1,20 @@
+#!/bin/sh
+#
+# Profile training run for "make pgo": the emulator feeds the daemon as fast
+# as the pseudo terminal goes, and scopetool records and exports what it
+# serves, which covers capture, decoding, packing and the recording paths.
+
+dir=`mktemp -d`
+trap 'kill $daemon $emu 2>/dev/null; rm -rf $dir' EXIT
+
+./scopeemu > $dir/tty &
+emu=$!
+sleep 0.5
+./scopeviewd -p 0 -l $dir/sock `head -1 $dir/tty` > /dev/null &
+daemon=$!
+sleep 0.5
+./scopetool record -c $dir/sock -n 200 $dir/train.svr
+./scopetool export -x 2 $dir/train.svr > /dev/null
+# frames keep the daemon's numbers, look up the tenth's in the index
+frame=`od -A n -t u8 -j 224 -N 8 $dir/train.svr.idx`
+./scopetool similar $dir/train.svr $frame $dir/train.svr > /dev/null
@@ -0,0 +1,167 @@
+/*
+ * About : Perceptual hashes of frames, see phash.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "phash.h"
+
+#define GRID 8
+#define CELL_W (FRAME_WIDTH/GRID)
+#define CELL_H (FRAME_HEIGHT/GRID)
+#define CHUNK_VALUES 65536
+
+static int compare_int(const void * a, const void * b) {
+    return *(const int *) a - *(const int *) b;
+}
+
+uint64_t phash_indexed(const uint8_t * indexed) {
+    int histogram[16] = {0};
+    int ink[GRID*GRID] = {0};
+    int sorted[GRID*GRID];
+    int i, x, y, background = 0, median;
+    uint64_t hash = 0;
+
+    for (i = 0; i < FRAME_PIXELS; i++) {
+	histogram[indexed[i] & 0x0f]++;
+    }
+    for (i = 1; i < 16; i++) {
+	if (histogram[i] > histogram[background]) {
+	    background = i;
+	}
+    }
+    for (y = 0; y < FRAME_HEIGHT; y++) {
+	for (x = 0; x < FRAME_WIDTH; x++) {
+	    ink[y / CELL_H * GRID + x / CELL_W] +=
+		indexed[y * FRAME_WIDTH + x] != background;
+	}
+    }
+    memcpy(sorted, ink, sizeof(sorted));
+    qsort(sorted, GRID*GRID, sizeof(int), compare_int);
+    median = sorted[GRID*GRID / 2];
+    for (i = 0; i < GRID*GRID; i++) {
+	if (ink[i] > median) {
+	    hash |= (uint64_t) 1 << i;
+	}
+    }
+    return hash;
+}
+
+int phash_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+static unsigned int chunk(uint64_t hash, int c) {
+    return (hash >> (c * 16)) & 0xffff;
+}
+
+/* returns 0 on success, or 1 if out of memory */
+int phash_index_build(phash_index * ix, const uint64_t * hashes, size_t count) {
+    uint32_t * next;
+    size_t i;
+    int c;
+
+    memset(ix, 0, sizeof(*ix));
+    ix->count = count;
+    ix->hashes = hashes;
+    next = malloc(CHUNK_VALUES * sizeof(uint32_t));
+    if (!next) {
+	return 1;
+    }
+    for (c = 0; c < PHASH_CHUNKS; c++) {
+	ix->offsets[c] = calloc(CHUNK_VALUES + 1, sizeof(uint32_t));
+	ix->ids[c] = malloc((count ? count : 1) * sizeof(uint32_t));
+	if (!ix->offsets[c] || !ix->ids[c]) {
+	    free(next);
+	    phash_index_free(ix);
+	    return 1;
+	}
+	/* counting sort by chunk value */
+	for (i = 0; i < count; i++) {
+	    ix->offsets[c][chunk(hashes[i], c) + 1]++;
+	}
+	for (i = 0; i < CHUNK_VALUES; i++) {
+	    ix->offsets[c][i + 1] += ix->offsets[c][i];
+	}
+	memcpy(next, ix->offsets[c], CHUNK_VALUES * sizeof(uint32_t));
+	for (i = 0; i < count; i++) {
+	    ix->ids[c][next[chunk(hashes[i], c)]++] = i;
+	}
+    }
+    free(next);
+    return 0;
+}
+
+/* compare the hashes filed under one chunk value */
+static size_t probe(const phash_index * ix, uint64_t hash, int radius,
+		    int c, unsigned int value, int slack,
+		    void (*found)(void *, size_t, int), void * ctx) {
+    size_t n = 0;
+    uint32_t i, id;
+    int d, earlier;
+
+    for (i = ix->offsets[c][value]; i < ix->offsets[c][value + 1]; i++) {
+	id = ix->ids[c][i];
+	d = phash_distance(hash, ix->hashes[id]);
+	if (d > radius) {
+	    continue;
+	}
+	/* report each hash once, under the first chunk that finds it */
+	for (earlier = 0; earlier < c; earlier++) {
+	    if (phash_distance(chunk(hash, earlier),
+			       chunk(ix->hashes[id], earlier)) <= slack) {
+		break;
+	    }
+	}
+	if (earlier == c) {
+	    found(ctx, id, d);
+	    n++;
+	}
+    }
+    return n;
+}
+
+/*
+ * call found() for every hash within radius bits of hash, in no particular
+ * order. returns how many there were.
+ */
+size_t phash_index_query(const phash_index * ix, uint64_t hash, int radius,
+			 void (*found)(void * ctx, size_t id, int distance),
+			 void * ctx) {
+    int slack = radius / PHASH_CHUNKS, c, a, b;
+    unsigned int value;
+    size_t i, n = 0;
+
+    if (radius > PHASH_MAX_RADIUS) {
+	for (i = 0; i < ix->count; i++) {
+	    if (phash_distance(hash, ix->hashes[i]) <= radius) {
+		found(ctx, i, phash_distance(hash, ix->hashes[i]));
+		n++;
+	    }
+	}
+	return n;
+    }
+    for (c = 0; c < PHASH_CHUNKS; c++) {
+	value = chunk(hash, c);
+	n += probe(ix, hash, radius, c, value, slack, found, ctx);
+	for (a = 0; slack >= 1 && a < 16; a++) {
+	    n += probe(ix, hash, radius, c, value ^ 1 << a, slack, found, ctx);
+	    for (b = a + 1; slack >= 2 && b < 16; b++) {
+		n += probe(ix, hash, radius, c, value ^ 1 << a ^ 1 << b, slack,
+			   found, ctx);
+	    }
+	}
+    }
+    return n;
+}
+
+void phash_index_free(phash_index * ix) {
+    int c;
+
+    for (c = 0; c < PHASH_CHUNKS; c++) {
+	free(ix->offsets[c]);
+	free(ix->ids[c]);
+    }
+    memset(ix, 0, sizeof(*ix));
+}
@@ -0,0 +1,52 @@
+/*
+ * About : Perceptual hashes of frames, for finding frames that look alike.
+ *
+ * Notes :
+ *
+ * The hash splits an indexed frame into an 8x8 grid and sets a cell's bit
+ * when it holds more non-background pixels than the median cell, the
+ * background being the most common color. Frames that look alike differ in
+ * few bits, whatever theme they are shown in.
+ *
+ * A phash_index finds all hashes within a Hamming distance of a query by
+ * multi-index hashing: each hash is split into four 16 bit chunks, and any
+ * hash within distance d of the query has a chunk within d/4 of the query's
+ * same chunk. Only hashes filed under those chunk values are compared.
+ *
+ * Recordings made with record_create_indexed() keep the hash of every frame
+ * in a file next to them, path + ".phash", one phash_entry per frame.
+ */
+
+#ifndef PHASH_H
+#define PHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PHASH_BITS 64
+#define PHASH_CHUNKS 4
+#define PHASH_MAX_RADIUS 11  /* beyond this a query compares every hash */
+
+struct phash_entry {
+    uint64_t hash;
+    uint64_t seq;
+    uint64_t timestamp;
+};
+
+typedef struct {
+    size_t count;
+    const uint64_t * hashes;
+    uint32_t * offsets[PHASH_CHUNKS];  /* 65537 each, into ids */
+    uint32_t * ids[PHASH_CHUNKS];  /* hash numbers sorted by chunk value */
+} phash_index;
+
+uint64_t phash_indexed(const uint8_t * indexed);
+int phash_distance(uint64_t a, uint64_t b);
+
+int phash_index_build(phash_index * ix, const uint64_t * hashes, size_t count);
+size_t phash_index_query(const phash_index * ix, uint64_t hash, int radius,
+			 void (*found)(void * ctx, size_t id, int distance),
+			 void * ctx);
+void phash_index_free(phash_index * ix);
+
+#endif
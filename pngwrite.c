@@ -0,0 +1,162 @@
+/*
+ * About : Minimal PNG writer on top of zlib.
+ *
+ * Notes :
+ *
+ * Writes a signature, IHDR, PLTE for indexed images, a single IDAT and IEND,
+ * with no row filtering. The scope's flat colors compress well enough
+ * without it.
+ *
+ * Indexed images are written at 4 bits/pixel, left pixel in the high nibble,
+ * which is exactly the layout of a packed frame (see decode.h), so those go
+ * out without any per-pixel work. The colors live only in the PLTE chunk,
+ * so a saved capture can be given another theme by replacing that chunk.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "pngwrite.h"
+
+static const uint8_t png_signature[8] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+static uint8_t * put_be32(uint8_t * p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+/* append a chunk at p, returns the end of it */
+static uint8_t * put_chunk(uint8_t * p, const char * type,
+			   const uint8_t * data, size_t length) {
+    uint32_t crc;
+
+    p = put_be32(p, length);
+    memcpy(p, type, 4);
+    if (length) {
+	memcpy(p + 4, data, length);
+    }
+    crc = crc32(0, p, length + 4);
+    return put_be32(p + 4 + length, crc);
+}
+
+/*
+ * write a PNG with the given rows of stride bytes each, prefixed with the
+ * filter byte here. colors is 0 for RGB images.
+ */
+static int png_write(const uint8_t * rows, size_t stride, int width,
+		     int height, int bit_depth, int color_type,
+		     const rgb_color * palette, int colors,
+		     uint8_t ** out, size_t * length) {
+    size_t raw_size = (stride + 1) * height;
+    uLongf z_size = compressBound(raw_size);
+    uint8_t ihdr[13], plte[3 * 256];
+    uint8_t * raw, * png, * p;
+    int y;
+
+    raw = malloc(raw_size);
+    png = malloc(sizeof(png_signature) + 4 * 12 + sizeof(ihdr) + 3 * colors
+		 + z_size);
+    if (!raw || !png) {
+	free(raw);
+	free(png);
+	return 1;
+    }
+    for (y = 0; y < height; y++) {
+	raw[y * (stride + 1)] = 0; /* filter type none */
+	memcpy(raw + y * (stride + 1) + 1, rows + y * stride, stride);
+    }
+
+    p = put_be32(ihdr, width);
+    p = put_be32(p, height);
+    p[0] = bit_depth;
+    p[1] = color_type;
+    p[2] = 0; /* deflate */
+    p[3] = 0; /* adaptive filtering */
+    p[4] = 0; /* no interlace */
+
+    memcpy(png, png_signature, sizeof(png_signature));
+    p = put_chunk(png + sizeof(png_signature), "IHDR", ihdr, sizeof(ihdr));
+    if (colors) {
+	for (y = 0; y < colors; y++) {
+	    plte[3*y] = palette[y].r;
+	    plte[3*y+1] = palette[y].g;
+	    plte[3*y+2] = palette[y].b;
+	}
+	p = put_chunk(p, "PLTE", plte, 3 * colors);
+    }
+    /* compress straight into place, the chunk header is filled in after */
+    if (compress2(p + 8, &z_size, raw, raw_size, Z_DEFAULT_COMPRESSION)
+	!= Z_OK) {
+	free(raw);
+	free(png);
+	return 1;
+    }
+    free(raw);
+    put_be32(p, z_size);
+    memcpy(p + 4, "IDAT", 4);
+    put_be32(p + 8 + z_size, crc32(0, p + 4, z_size + 4));
+    p = put_chunk(p + 12 + z_size, "IEND", NULL, 0);
+
+    *out = png;
+    *length = p - png;
+    return 0;
+}
+
+/*
+ * encode 8 bit RGB pixels. on success returns 0 and a malloc'd PNG in *out,
+ * which the caller frees.
+ */
+int png_encode_rgb(const uint8_t * rgb, int width, int height,
+		   uint8_t ** out, size_t * length) {
+    return png_write(rgb, (size_t) width * 3, width, height, 8, 2, NULL, 0,
+		     out, length);
+}
+
+/* encode a packed 4 bit frame with a 16 color palette, as above */
+int png_encode_packed(const uint8_t * packed, int width, int height,
+		      const rgb_color * palette, uint8_t ** out,
+		      size_t * length) {
+    return png_write(packed, (size_t) (width + 1) / 2, width, height, 4, 3,
+		     palette, 16, out, length);
+}
+
+/*
+ * give an indexed PNG in memory another palette, in place. returns 0 on
+ * success, or 1 if it isn't a PNG with a 16 color PLTE chunk.
+ */
+int png_set_palette(uint8_t * png, size_t length, const rgb_color * palette) {
+    size_t p = sizeof(png_signature);
+    uint32_t chunk_len;
+    uint8_t * data;
+    int i;
+
+    if (length < p || memcmp(png, png_signature, p)) {
+	return 1;
+    }
+    while (p + 12 <= length) {
+	chunk_len = (uint32_t) png[p] << 24 | png[p+1] << 16 | png[p+2] << 8
+	    | png[p+3];
+	if (chunk_len > length - p - 12) {
+	    return 1;
+	}
+	if (!memcmp(png + p + 4, "PLTE", 4)) {
+	    if (chunk_len != 3 * 16) {
+		return 1;
+	    }
+	    data = png + p + 8;
+	    for (i = 0; i < 16; i++) {
+		data[3*i] = palette[i].r;
+		data[3*i+1] = palette[i].g;
+		data[3*i+2] = palette[i].b;
+	    }
+	    put_be32(data + chunk_len, crc32(0, png + p + 4, chunk_len + 4));
+	    return 0;
+	}
+	p += 12 + chunk_len;
+    }
+    return 1;
+}
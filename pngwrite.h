@@ -0,0 +1,19 @@
+/*
+ * About : Minimal PNG writer on top of zlib.
+ */
+
+#ifndef PNGWRITE_H
+#define PNGWRITE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "palette.h"
+
+int png_encode_rgb(const uint8_t * rgb, int width, int height,
+		   uint8_t ** out, size_t * length);
+int png_encode_packed(const uint8_t * packed, int width, int height,
+		      const rgb_color * palette, uint8_t ** out,
+		      size_t * length);
+int png_set_palette(uint8_t * png, size_t length, const rgb_color * palette);
+
+#endif
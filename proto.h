@@ -0,0 +1,75 @@
+/*
+ * About : Wire protocol between scopeviewd and its clients.
+ *
+ * Notes :
+ *
+ * Clients connect to the daemon's Unix domain stream socket and receive a
+ * stream of messages, each a proto_header followed by length bytes of
+ * payload. A MSG_FRAME payload is one packed frame (see decode.h). Frames
+ * are numbered by seq, so a client that was too slow to keep up sees a gap
+ * where the daemon skipped frames for it.
+ *
+ * Clients may also send MSG_COMMAND messages carrying a raw scope command
+ * (e.g. ":MEASure:FREQuency?\n"). The daemon runs commands on the serial port
+ * between screen dumps, never in the middle of one, and answers each with a
+ * MSG_REPLY carrying the same seq and a CMD_STATUS_* in flags. For commands:
+ *
+ *   flags  priority (CMD_PRIO_*), plus CMD_REPLY if the scope answers with
+ *          a line that should be read back
+ *   arg    deadline in milliseconds from receipt, 0 for none. A command that
+ *          can't be started before its deadline is answered with
+ *          CMD_STATUS_EXPIRED instead of being sent to the scope.
+ *
+ * CMD_PRIO_HIGH commands always go before the next screen dump,
+ * CMD_PRIO_NORMAL ones may delay it by a few commands only, and CMD_PRIO_LOW
+ * ones use the idle time between dumps, or when there is none (polling back
+ * to back) get a turn after every few dumps. Within a priority, earlier
+ * deadlines go first.
+ *
+ * All fields are native endian, the socket never leaves the machine.
+ */
+
+#ifndef PROTO_H
+#define PROTO_H
+
+#include <stdint.h>
+#include "decode.h"
+
+#define PROTO_MAGIC 0x31445653  /* "SVD1" */
+#define PROTO_DEFAULT_SOCKET "/tmp/scopeviewd.sock"
+#define PROTO_MAX_PAYLOAD FRAME_PACKED_SIZE
+#define CMD_MAX 256  /* longest command or reply */
+
+enum {
+    MSG_FRAME = 1,
+    MSG_COMMAND,
+    MSG_REPLY
+};
+
+enum {
+    CMD_PRIO_LOW = 0,
+    CMD_PRIO_NORMAL,
+    CMD_PRIO_HIGH
+};
+#define CMD_PRIO_MASK 0x0003
+#define CMD_REPLY 0x0100
+
+enum {
+    CMD_STATUS_OK = 0,
+    CMD_STATUS_EXPIRED,  /* deadline passed before the command could run */
+    CMD_STATUS_TIMEOUT,  /* scope didn't answer */
+    CMD_STATUS_BUSY,  /* too many commands queued */
+    CMD_STATUS_INVALID
+};
+
+struct proto_header {
+    uint32_t magic;
+    uint16_t type;
+    uint16_t flags;
+    uint32_t length;  /* payload bytes following this header */
+    uint32_t arg;  /* type specific, see above */
+    uint64_t seq;  /* frame number (starts at 1) or command id */
+    uint64_t timestamp;  /* capture time, microseconds since the epoch */
+};
+
+#endif
@@ -0,0 +1,444 @@
+/*
+ * About : Readout recognition and index, see readout.h.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decode.h"
+#include "readout.h"
+
+#define SPACE_COLUMNS 3  /* blank columns that make a space between words */
+
+const char * readout_names[READOUT_FIELDS] =
+    {"CH1", "CH2", "Time", "Trig", "Freq"};
+
+/*
+ * where the readouts are on screen, taken from a GDS-820C screen dump. the
+ * status line along the bottom holds both channels, the timebase and the
+ * trigger, the frequency counter is in the top right corner.
+ */
+static const struct {
+    int x, y, w, h;
+} boxes[READOUT_FIELDS] = {
+    {0, 226, 80, 12},
+    {80, 226, 80, 12},
+    {160, 226, 80, 12},
+    {240, 226, 80, 12},
+    {230, 2, 90, 12}};
+
+/* returns 0 on success */
+int readout_font_load(readout_font * font, const char * path) {
+    char line[128], c;
+    unsigned long long key;
+    FILE * f;
+
+    memset(font, 0, sizeof(*font));
+    f = fopen(path, "r");
+    if (!f) {
+	return 1;
+    }
+    while (fgets(line, sizeof(line), f) && font->count < READOUT_MAX_GLYPHS) {
+	if (line[0] != '#' && sscanf(line, "%llx %c", &key, &c) == 2) {
+	    font->keys[font->count] = key;
+	    font->chars[font->count++] = c;
+	}
+    }
+    fclose(f);
+    return 0;
+}
+
+/* FNV-1a over the glyph's size and foreground bits */
+uint64_t readout_glyph_key(const uint8_t * indexed, int x0, int x1, int y0,
+			   int y1, int background) {
+    uint64_t key = 0xcbf29ce484222325ULL;
+    int x, y;
+
+    key = (key ^ (x1 - x0)) * 0x100000001b3ULL;
+    for (y = y0; y < y1; y++) {
+	for (x = x0; x < x1; x++) {
+	    key = (key ^ (indexed[y * FRAME_WIDTH + x] != background))
+		* 0x100000001b3ULL;
+	}
+    }
+    return key;
+}
+
+static char glyph_char(const readout_font * font, uint64_t key) {
+    int i;
+
+    for (i = 0; i < font->count; i++) {
+	if (font->keys[i] == key) {
+	    return font->chars[i];
+	}
+    }
+    return '?';
+}
+
+static int box_background(const uint8_t * indexed, int field) {
+    int histogram[16] = {0};
+    int x, y, background = 0;
+
+    for (y = boxes[field].y; y < boxes[field].y + boxes[field].h; y++) {
+	for (x = boxes[field].x; x < boxes[field].x + boxes[field].w; x++) {
+	    histogram[indexed[y * FRAME_WIDTH + x] & 0x0f]++;
+	}
+    }
+    for (x = 1; x < 16; x++) {
+	if (histogram[x] > histogram[background]) {
+	    background = x;
+	}
+    }
+    return background;
+}
+
+static int column_blank(const uint8_t * indexed, int field, int x,
+			int background) {
+    int y;
+
+    for (y = boxes[field].y; y < boxes[field].y + boxes[field].h; y++) {
+	if (indexed[y * FRAME_WIDTH + x] != background) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+/*
+ * cut the text in a box into glyphs, calling glyph() with each one's
+ * columns, or with x0 == x1 for a space. returns the number of glyphs.
+ */
+static int box_glyphs(const uint8_t * indexed, int field, int background,
+		      void (*glyph)(void * ctx, int x0, int x1), void * ctx) {
+    int x = boxes[field].x, end = boxes[field].x + boxes[field].w;
+    int x0, blank = 0, n = 0;
+
+    while (x < end) {
+	if (column_blank(indexed, field, x, background)) {
+	    blank++;
+	    x++;
+	    continue;
+	}
+	if (n && blank >= SPACE_COLUMNS) {
+	    glyph(ctx, x, x);
+	}
+	for (x0 = x; x < end && !column_blank(indexed, field, x, background);
+	     x++) {
+	}
+	glyph(ctx, x0, x);
+	blank = 0;
+	n++;
+    }
+    return n;
+}
+
+struct recognize_state {
+    const uint8_t * indexed;
+    const readout_font * font;
+    int field, background, length;
+    char * text;
+};
+
+static void recognize_glyph(void * ctx, int x0, int x1) {
+    struct recognize_state * s = ctx;
+
+    if (s->length == READOUT_TEXT - 1) {
+	return;
+    }
+    s->text[s->length++] = x0 == x1 ? ' ' : glyph_char(s->font,
+	readout_glyph_key(s->indexed, x0, x1, boxes[s->field].y,
+			  boxes[s->field].y + boxes[s->field].h,
+			  s->background));
+}
+
+/* the text of every readout, "" where a box is empty */
+void readout_recognize(const uint8_t * indexed, const readout_font * font,
+		       char text[READOUT_FIELDS][READOUT_TEXT]) {
+    struct recognize_state s;
+
+    s.indexed = indexed;
+    s.font = font;
+    for (s.field = 0; s.field < READOUT_FIELDS; s.field++) {
+	s.background = box_background(indexed, s.field);
+	s.length = 0;
+	s.text = text[s.field];
+	box_glyphs(indexed, s.field, s.background, recognize_glyph, &s);
+	s.text[s.length] = 0;
+    }
+}
+
+struct print_state {
+    FILE * out;
+    const uint8_t * indexed;
+    const readout_font * font;
+    int field, background;
+};
+
+static void print_glyph(void * ctx, int x0, int x1) {
+    struct print_state * s = ctx;
+    uint64_t key;
+    int x, y;
+
+    if (x0 == x1) {
+	return;
+    }
+    key = readout_glyph_key(s->indexed, x0, x1, boxes[s->field].y,
+			    boxes[s->field].y + boxes[s->field].h,
+			    s->background);
+    fprintf(s->out, "%016llx %c\n", (unsigned long long) key,
+	    glyph_char(s->font, key));
+    for (y = boxes[s->field].y; y < boxes[s->field].y + boxes[s->field].h;
+	 y++) {
+	fprintf(s->out, "# ");
+	for (x = x0; x < x1; x++) {
+	    fputc(s->indexed[y * FRAME_WIDTH + x] != s->background ? '#' : '.',
+		  s->out);
+	}
+	fputc('\n', s->out);
+    }
+}
+
+/*
+ * print every glyph in the readout boxes as a font file line, followed by
+ * its bitmap as comments, for filling in the characters by hand
+ */
+void readout_glyphs(FILE * out, const uint8_t * indexed,
+		    const readout_font * font) {
+    struct print_state s;
+
+    s.out = out;
+    s.indexed = indexed;
+    s.font = font;
+    for (s.field = 0; s.field < READOUT_FIELDS; s.field++) {
+	fprintf(out, "# %s\n", readout_names[s.field]);
+	s.background = box_background(indexed, s.field);
+	box_glyphs(indexed, s.field, s.background, print_glyph, &s);
+    }
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/*
+ * the value of the last number in text, scaled by any SI prefix after it,
+ * so "CH1 5mV" gives 0.005 and "10.0kHz" 10000. digits stuck to letters
+ * before them, as in "CH1", are part of a label. returns 0 on success.
+ */
+int readout_number(const char * text, double * number) {
+    const char * p, * start = NULL;
+    char * end;
+    double v;
+
+    for (p = text; *p; p++) {
+	if (is_digit(*p) && (p == text || p[-1] == ' ' || p[-1] == '-'
+			     || p[-1] == '+')) {
+	    start = p > text && p[-1] != ' ' ? p - 1 : p;
+	}
+    }
+    if (!start) {
+	return 1;
+    }
+    v = strtod(start, &end);
+    switch (*end) {
+    case 'n': v *= 1e-9; break;
+    case 'u': v *= 1e-6; break;
+    case 'm': v *= 1e-3; break;
+    case 'k': v *= 1e3; break;
+    case 'M': v *= 1e6; break;
+    }
+    *number = v;
+    return 0;
+}
+
+/* returns 0 on success */
+int readout_log_open(readout_log * log, const char * path) {
+    char text_path[4096];
+
+    memset(log, 0, sizeof(*log));
+    snprintf(text_path, sizeof(text_path), "%s.text", path);
+    log->f = fopen(text_path, "wb");
+    return !log->f;
+}
+
+static int end_run(readout_log * log, int field) {
+    return fwrite(&log->runs[field], sizeof(struct readout_run), 1, log->f)
+	!= 1;
+}
+
+/*
+ * note the readouts of the next frame, writing out the runs of those that
+ * changed. returns nonzero on a write error.
+ */
+int readout_log_frame(readout_log * log, uint64_t seq, uint64_t timestamp,
+		      char text[READOUT_FIELDS][READOUT_TEXT]) {
+    struct readout_run * run;
+    int field, rv = 0, ended = 0;
+
+    for (field = 0; field < READOUT_FIELDS; field++) {
+	run = &log->runs[field];
+	if (log->started && !strcmp(run->text, text[field])) {
+	    run->last_seq = seq;
+	    run->last_timestamp = timestamp;
+	    continue;
+	}
+	if (log->started) {
+	    rv |= end_run(log, field);
+	    ended = 1;
+	}
+	memset(run, 0, sizeof(*run));
+	run->field = field;
+	strcpy(run->text, text[field]);
+	if (readout_number(run->text, &run->number)) {
+	    run->number = NAN;
+	}
+	run->first_seq = run->last_seq = seq;
+	run->first_timestamp = run->last_timestamp = timestamp;
+    }
+    log->started = 1;
+    return rv || (ended && fflush(log->f));
+}
+
+/* write out the runs still going on, returns nonzero on a write error */
+int readout_log_close(readout_log * log) {
+    int field, rv = 0;
+
+    if (!log->f) {
+	return 0;
+    }
+    for (field = 0; log->started && field < READOUT_FIELDS; field++) {
+	rv |= end_run(log, field);
+    }
+    rv |= fclose(log->f) != 0;
+    log->f = NULL;
+    return rv;
+}
+
+static int compare_number(const void * a, const void * b) {
+    const struct readout_run * x = *(struct readout_run * const *) a;
+    const struct readout_run * y = *(struct readout_run * const *) b;
+
+    if (x->field != y->field) {
+	return x->field < y->field ? -1 : 1;
+    }
+    if (isnan(x->number) || isnan(y->number)) {
+	return isnan(x->number) - isnan(y->number);
+    }
+    return x->number < y->number ? -1 : x->number > y->number;
+}
+
+static int compare_text(const void * a, const void * b) {
+    const struct readout_run * x = *(struct readout_run * const *) a;
+    const struct readout_run * y = *(struct readout_run * const *) b;
+
+    if (x->field != y->field) {
+	return x->field < y->field ? -1 : 1;
+    }
+    return strcmp(x->text, y->text);
+}
+
+/* load the runs kept next to a recording. returns 0 on success */
+int readout_index_load(readout_index * ix, const char * path) {
+    char text_path[4096];
+    size_t i;
+    long size;
+    FILE * f;
+
+    memset(ix, 0, sizeof(*ix));
+    snprintf(text_path, sizeof(text_path), "%s.text", path);
+    f = fopen(text_path, "rb");
+    if (!f) {
+	return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    rewind(f);
+    ix->count = size / sizeof(struct readout_run);
+    ix->runs = malloc((ix->count + 1) * sizeof(struct readout_run));
+    ix->by_number = malloc((ix->count + 1) * sizeof(*ix->by_number));
+    ix->by_text = malloc((ix->count + 1) * sizeof(*ix->by_text));
+    if (!ix->runs || !ix->by_number || !ix->by_text
+	|| fread(ix->runs, sizeof(struct readout_run), ix->count, f)
+	   != ix->count) {
+	fclose(f);
+	readout_index_free(ix);
+	return 1;
+    }
+    fclose(f);
+    for (i = 0; i < ix->count; i++) {
+	ix->runs[i].text[READOUT_TEXT - 1] = 0;
+	ix->by_number[i] = ix->by_text[i] = &ix->runs[i];
+    }
+    qsort(ix->by_number, ix->count, sizeof(*ix->by_number), compare_number);
+    qsort(ix->by_text, ix->count, sizeof(*ix->by_text), compare_text);
+    return 0;
+}
+
+/* first position in order where run is not before field/key */
+static size_t lower_bound(const readout_index * ix,
+			  struct readout_run * const * order,
+			  int field, double low, const char * text) {
+    const struct readout_run * r;
+    size_t lo = 0, hi = ix->count, mid;
+    int before;
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	r = order[mid];
+	if ((int) r->field != field) {
+	    before = (int) r->field < field;
+	} else if (text) {
+	    before = strcmp(r->text, text) < 0;
+	} else {
+	    before = !isnan(r->number) && r->number < low;
+	}
+	if (before) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return lo;
+}
+
+/*
+ * runs of field with a value from low to high, inclusive. returns how many,
+ * ix->by_number[*first] being the first of them.
+ */
+size_t readout_index_range(const readout_index * ix, int field, double low,
+			   double high, size_t * first) {
+    size_t i = lower_bound(ix, ix->by_number, field, low, NULL);
+    const struct readout_run * r;
+
+    *first = i;
+    for (; i < ix->count; i++) {
+	r = ix->by_number[i];
+	if ((int) r->field != field || isnan(r->number) || r->number > high) {
+	    break;
+	}
+    }
+    return i - *first;
+}
+
+/* runs of field showing exactly text, starting at ix->by_text[*first] */
+size_t readout_index_text(const readout_index * ix, int field,
+			  const char * text, size_t * first) {
+    size_t i = lower_bound(ix, ix->by_text, field, 0, text);
+    const struct readout_run * r;
+
+    *first = i;
+    for (; i < ix->count; i++) {
+	r = ix->by_text[i];
+	if ((int) r->field != field || strcmp(r->text, text)) {
+	    break;
+	}
+    }
+    return i - *first;
+}
+
+void readout_index_free(readout_index * ix) {
+    free(ix->runs);
+    free(ix->by_number);
+    free(ix->by_text);
+    memset(ix, 0, sizeof(*ix));
+}
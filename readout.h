@@ -0,0 +1,90 @@
+/*
+ * About : Recognizing the scope's on-screen readouts, and an index of them.
+ *
+ * Notes :
+ *
+ * Each readout (channel scales, timebase, trigger level, frequency) sits in
+ * a fixed box on screen, see the table in readout.c. Text in a box is cut
+ * into glyphs at blank columns, and each glyph is looked up by a hash of its
+ * bitmap in a font file, lines of "<key in hex> <character>". scopetool
+ * glyphs prints the keys of the glyphs in a frame, to write one.
+ *
+ * While recording, a readout_log notes each run of frames over which a
+ * readout kept its value, in a file next to the recording, path + ".text",
+ * one readout_run per run. A readout_index loads those runs and sorts them
+ * by field and value, so frames can be found by what they showed, including
+ * numeric ranges, without decoding any of them.
+ */
+
+#ifndef READOUT_H
+#define READOUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#define READOUT_TEXT 24
+#define READOUT_MAX_GLYPHS 512
+#define READOUT_DEFAULT_FONT "readouts.font"
+
+enum {
+    READOUT_CH1,
+    READOUT_CH2,
+    READOUT_TIME,
+    READOUT_TRIG,
+    READOUT_FREQ,
+    READOUT_FIELDS
+};
+
+extern const char * readout_names[READOUT_FIELDS];
+
+typedef struct {
+    int count;
+    uint64_t keys[READOUT_MAX_GLYPHS];
+    char chars[READOUT_MAX_GLYPHS];
+} readout_font;
+
+struct readout_run {
+    uint32_t field;
+    uint32_t reserved;
+    double number;  /* value of the readout, NaN if it isn't numeric */
+    uint64_t first_seq, last_seq;
+    uint64_t first_timestamp, last_timestamp;
+    char text[READOUT_TEXT];
+};
+
+typedef struct {
+    FILE * f;
+    int started;
+    struct readout_run runs[READOUT_FIELDS];  /* runs still going on */
+} readout_log;
+
+typedef struct {
+    size_t count;
+    struct readout_run * runs;
+    struct readout_run ** by_number;  /* runs by field then number */
+    struct readout_run ** by_text;  /* runs by field then text */
+} readout_index;
+
+int readout_font_load(readout_font * font, const char * path);
+uint64_t readout_glyph_key(const uint8_t * indexed, int x0, int x1, int y0,
+			   int y1, int background);
+void readout_recognize(const uint8_t * indexed, const readout_font * font,
+		       char text[READOUT_FIELDS][READOUT_TEXT]);
+void readout_glyphs(FILE * out, const uint8_t * indexed,
+		    const readout_font * font);
+int readout_number(const char * text, double * number);
+
+int readout_log_open(readout_log * log, const char * path);
+int readout_log_frame(readout_log * log, uint64_t seq, uint64_t timestamp,
+		      char text[READOUT_FIELDS][READOUT_TEXT]);
+int readout_log_close(readout_log * log);
+
+int readout_index_load(readout_index * ix, const char * path);
+size_t readout_index_range(const readout_index * ix, int field, double low,
+			   double high, size_t * first);
+size_t readout_index_text(const readout_index * ix, int field,
+			  const char * text, size_t * first);
+void readout_index_free(readout_index * ix);
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * About : Recording files, see record.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "phash.h"
+#include "record.h"
+
+#define DELTA_SPAN_HEADER 4
+#define DELTA_MIN_GAP 4  /* shorter unchanged runs are kept inside a span */
+
+static void put_le16(uint8_t * p, unsigned int v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static unsigned int get_le16(const uint8_t * p) {
+    return p[0] | p[1] << 8;
+}
+
+/*
+ * spans of bytes that changed from prev to cur. returns the encoded length,
+ * or -1 if it would be no smaller than the frame itself.
+ */
+static int delta_encode(const uint8_t * prev, const uint8_t * cur,
+			uint8_t * out) {
+    int i = 0, j, pos = 0, n = 0, start;
+
+    while (i < FRAME_PACKED_SIZE) {
+	while (i < FRAME_PACKED_SIZE && prev[i] == cur[i]) {
+	    i++;
+	}
+	if (i == FRAME_PACKED_SIZE) {
+	    break;
+	}
+	start = i;
+	while (i < FRAME_PACKED_SIZE) {
+	    if (prev[i] != cur[i]) {
+		i++;
+		continue;
+	    }
+	    for (j = i; j < FRAME_PACKED_SIZE && j - i < DELTA_MIN_GAP
+		     && prev[j] == cur[j]; j++) {
+	    }
+	    if (j == FRAME_PACKED_SIZE || j - i == DELTA_MIN_GAP) {
+		break;
+	    }
+	    i = j;
+	}
+	if (n + DELTA_SPAN_HEADER + (i - start) >= FRAME_PACKED_SIZE) {
+	    return -1;
+	}
+	put_le16(out + n, start - pos);
+	put_le16(out + n + 2, i - start);
+	memcpy(out + n + DELTA_SPAN_HEADER, cur + start, i - start);
+	n += DELTA_SPAN_HEADER + (i - start);
+	pos = i;
+    }
+    return n;
+}
+
+/* apply spans to frame in place, returns nonzero if they don't fit */
+static int delta_apply(uint8_t * frame, const uint8_t * delta, int length) {
+    int n = 0, pos = 0, len;
+
+    while (n + DELTA_SPAN_HEADER <= length) {
+	pos += get_le16(delta + n);
+	len = get_le16(delta + n + 2);
+	n += DELTA_SPAN_HEADER;
+	if (pos + len > FRAME_PACKED_SIZE || n + len > length) {
+	    return 1;
+	}
+	memcpy(frame + pos, delta + n, len);
+	pos += len;
+	n += len;
+    }
+    return n != length;
+}
+
+/* returns 0 on success */
+int record_create(recording * r, const char * path) {
+    struct record_file_header fh;
+
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "wb");
+    if (!r->f) {
+	return 1;
+    }
+    r->writing = 1;
+    memset(&fh, 0, sizeof(fh));
+    fh.magic = RECORD_MAGIC;
+    fh.version = RECORD_VERSION;
+    fh.width = FRAME_WIDTH;
+    fh.height = FRAME_HEIGHT;
+    if (fwrite(&fh, sizeof(fh), 1, r->f) != 1) {
+	fclose(r->f);
+	r->f = NULL;
+	return 1;
+    }
+    return 0;
+}
+
+/* as record_create(), plus the index and hash files kept up as we write */
+int record_create_indexed(recording * r, const char * path) {
+    char index_path[4096];
+
+    if (record_create(r, path)) {
+	return 1;
+    }
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    r->index = fopen(index_path, "wb");
+    snprintf(index_path, sizeof(index_path), "%s.phash", path);
+    r->hashes = fopen(index_path, "wb");
+    if (!r->index || !r->hashes) {
+	record_close(r);
+	return 1;
+    }
+    return 0;
+}
+
+static int write_hash(recording * r, uint64_t seq, uint64_t timestamp,
+		      const uint8_t * packed) {
+    struct phash_entry entry;
+
+    decode_unpack(packed, r->scratch);
+    entry.hash = phash_indexed(r->scratch);
+    entry.seq = seq;
+    entry.timestamp = timestamp;
+    return fwrite(&entry, sizeof(entry), 1, r->hashes) != 1
+	|| fflush(r->hashes);
+}
+
+static int write_record(recording * r, int type, uint64_t seq,
+			uint64_t timestamp, const uint8_t * data,
+			size_t length) {
+    struct record_header hdr;
+
+    hdr.type = type;
+    hdr.length = length;
+    hdr.seq = seq;
+    hdr.timestamp = timestamp;
+    /* an empty delta (an unchanged frame) is just the header */
+    if (fwrite(&hdr, sizeof(hdr), 1, r->f) != 1
+	|| (length && fwrite(data, length, 1, r->f) != 1)) {
+	return 1;
+    }
+    r->frames++;
+    return 0;
+}
+
+/* store a full frame, indexed if the recording has an index */
+int record_write(recording * r, uint64_t seq, uint64_t timestamp,
+		 const uint8_t * packed) {
+    struct record_index_entry entry;
+
+    entry.timestamp = timestamp;
+    entry.seq = seq;
+    entry.offset = ftell(r->f);
+    if (write_record(r, REC_FRAME, seq, timestamp, packed,
+		     FRAME_PACKED_SIZE)) {
+	return 1;
+    }
+    if (r->hashes && write_hash(r, seq, timestamp, packed)) {
+	return 1;
+    }
+    return r->index && (fwrite(&entry, sizeof(entry), 1, r->index) != 1
+			|| fflush(r->index));
+}
+
+/*
+ * store a frame as a delta against the previous one where that pays off,
+ * indexing full frames. everything is flushed, so the files stay usable if
+ * the process dies.
+ */
+int record_append(recording * r, uint64_t seq, uint64_t timestamp,
+		  const uint8_t * packed) {
+    uint8_t * delta = r->scratch;
+    int n = -1;
+
+    if (r->have_prev && r->since_key < RECORD_KEY_INTERVAL) {
+	n = delta_encode(r->prev, packed, delta);
+    }
+    if (n >= 0) {
+	if (write_record(r, REC_DELTA, seq, timestamp, delta, n)
+	    || (r->hashes && write_hash(r, seq, timestamp, packed))) {
+	    return 1;
+	}
+	r->since_key++;
+    } else {
+	if (record_write(r, seq, timestamp, packed)) {
+	    return 1;
+	}
+	r->since_key = 0;
+    }
+    memcpy(r->prev, packed, FRAME_PACKED_SIZE);
+    r->have_prev = 1;
+    return fflush(r->f) != 0;
+}
+
+/* returns 0 on success, or 1 if path isn't a recording we understand */
+int record_open(recording * r, const char * path) {
+    struct record_file_header fh;
+
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (!r->f) {
+	return 1;
+    }
+    if (fread(&fh, sizeof(fh), 1, r->f) != 1 || fh.magic != RECORD_MAGIC
+	|| fh.version != RECORD_VERSION || fh.width != FRAME_WIDTH
+	|| fh.height != FRAME_HEIGHT) {
+	fclose(r->f);
+	return 1;
+    }
+    return 0;
+}
+
+/*
+ * read the next frame. returns 1 with hdr and packed filled in, 0 at the end
+ * of the recording, or -1 if it is damaged.
+ */
+int record_read(recording * r, struct record_header * hdr, uint8_t * packed) {
+    uint8_t * delta = r->scratch;
+
+    while (fread(hdr, sizeof(*hdr), 1, r->f) == 1) {
+	if (hdr->type == REC_FRAME && hdr->length == FRAME_PACKED_SIZE) {
+	    if (fread(r->prev, FRAME_PACKED_SIZE, 1, r->f) != 1) {
+		return -1;
+	    }
+	    r->have_prev = 1;
+	} else if (hdr->type == REC_DELTA && hdr->length < FRAME_PACKED_SIZE) {
+	    if (fread(delta, hdr->length, 1, r->f) != 1 && hdr->length) {
+		return -1;
+	    }
+	    if (!r->have_prev) {
+		continue; /* nothing to apply it to, wait for a full frame */
+	    }
+	    if (delta_apply(r->prev, delta, hdr->length)) {
+		return -1;
+	    }
+	} else {
+	    if (fseek(r->f, hdr->length, SEEK_CUR)) {
+		return -1;
+	    }
+	    continue;
+	}
+	memcpy(packed, r->prev, FRAME_PACKED_SIZE);
+	r->frames++;
+	return 1;
+    }
+    return feof(r->f) ? 0 : -1;
+}
+
+/*
+ * position an open recording at the last full frame at or before timestamp,
+ * using the index next to path. reading on from there reaches the wanted
+ * moment after at most RECORD_KEY_INTERVAL frames. without an index, the
+ * recording is just rewound. returns 0 on success.
+ */
+int record_seek(recording * r, const char * path, uint64_t timestamp) {
+    struct record_index_entry entry;
+    char index_path[4096];
+    long lo, hi, mid, count;
+    uint64_t offset = sizeof(struct record_file_header);
+    FILE * index;
+
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    index = fopen(index_path, "rb");
+    if (index) {
+	fseek(index, 0, SEEK_END);
+	count = ftell(index) / (long) sizeof(entry);
+	/* binary search for the last entry not after timestamp */
+	lo = 0;
+	hi = count - 1;
+	while (lo <= hi) {
+	    mid = (lo + hi) / 2;
+	    if (fseek(index, mid * (long) sizeof(entry), SEEK_SET)
+		|| fread(&entry, sizeof(entry), 1, index) != 1) {
+		break;
+	    }
+	    if (entry.timestamp <= timestamp) {
+		offset = entry.offset;
+		lo = mid + 1;
+	    } else {
+		hi = mid - 1;
+	    }
+	}
+	fclose(index);
+    }
+    r->have_prev = 0;
+    return fseek(r->f, offset, SEEK_SET) != 0;
+}
+
+/* returns nonzero if anything written could not be flushed */
+int record_close(recording * r) {
+    int rv;
+
+    if (!r->f) {
+	return 0;
+    }
+    rv = fclose(r->f);
+    if (r->index) {
+	rv |= fclose(r->index);
+    }
+    if (r->hashes) {
+	rv |= fclose(r->hashes);
+    }
+    r->f = NULL;
+    r->index = NULL;
+    r->hashes = NULL;
+    return rv != 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * About : Recording files, a sequence of frames with their timestamps.
+ *
+ * Notes :
+ *
+ * A recording starts with a record_file_header and is followed by records,
+ * each a record_header and length bytes of payload. A REC_FRAME payload is
+ * one packed frame (see decode.h). Readers skip record types they don't
+ * know, so new ones can be added without breaking old files.
+ *
+ * Recordings written with record_append() store most frames as REC_DELTA
+ * records against the frame before them: a list of (skip, length, bytes)
+ * spans, skip and length 16 bit, that replace the changed bytes of the
+ * packed frame. Every RECORD_KEY_INTERVAL frames, and whenever a delta
+ * wouldn't be smaller, a full REC_FRAME is stored instead, so a reader never
+ * has to go far back to rebuild a frame.
+ *
+ * Such recordings also get an index file next to them, path + ".idx", with
+ * one record_index_entry per full frame. record_seek() uses it to get to
+ * any moment without reading the file from the start. They also get a
+ * ".phash" file with the perceptual hash of every frame, see phash.h.
+ *
+ * All fields are little endian, which is what every machine this runs on
+ * uses natively.
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "decode.h"
+
+#define RECORD_MAGIC 0x43525653  /* "SVRC" */
+#define RECORD_VERSION 1
+#define RECORD_KEY_INTERVAL 64
+
+enum {
+    REC_FRAME = 1,
+    REC_DELTA
+};
+
+struct record_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint8_t reserved[16];
+};
+
+struct record_header {
+    uint32_t type;
+    uint32_t length;
+    uint64_t seq;  /* frame number as seen by whoever captured it */
+    uint64_t timestamp;  /* capture time, microseconds since the epoch */
+};
+
+struct record_index_entry {
+    uint64_t timestamp;
+    uint64_t seq;
+    uint64_t offset;  /* of the REC_FRAME's record_header in the recording */
+};
+
+typedef struct {
+    FILE * f;
+    FILE * index;
+    FILE * hashes;
+    int writing;
+    uint64_t frames;
+    int have_prev;
+    int since_key;  /* deltas written since the last full frame */
+    uint8_t prev[FRAME_PACKED_SIZE];  /* last frame, deltas apply to it */
+    uint8_t scratch[FRAME_PIXELS];
+} recording;
+
+int record_create(recording * r, const char * path);
+int record_create_indexed(recording * r, const char * path);
+int record_write(recording * r, uint64_t seq, uint64_t timestamp,
+		 const uint8_t * packed);
+int record_append(recording * r, uint64_t seq, uint64_t timestamp,
+		  const uint8_t * packed);
+int record_open(recording * r, const char * path);
+int record_read(recording * r, struct record_header * hdr, uint8_t * packed);
+int record_seek(recording * r, const char * path, uint64_t timestamp);
+int record_close(recording * r);
+
+#endif
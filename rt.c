@@ -0,0 +1,68 @@
+/*
+ * About : Keeping a thread's timing steady, see rt.h.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "rt.h"
+
+/* touch every page, so they are all there before anyone needs them */
+void rt_prefault(void * p, size_t length) {
+    long page = sysconf(_SC_PAGESIZE);
+    volatile char * c = p;
+    size_t i;
+
+    for (i = 0; i < length; i += page) {
+	c[i] = c[i];
+    }
+}
+
+/*
+ * lock all memory, present and future, and grow the heap by heap bytes of
+ * pre-faulted memory that malloc keeps. returns 0 or an errno value.
+ */
+int rt_lock_memory(size_t heap) {
+    void * p;
+
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+	return errno;
+    }
+    p = malloc(heap);
+    if (p) {
+	memset(p, 0, heap);
+	free(p);
+    }
+    return 0;
+}
+
+int rt_pin_thread(int cpu) {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+int rt_set_fifo(int priority) {
+    struct sched_param param;
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+/* the CPU least likely to be busy with interrupts and everything else */
+int rt_last_cpu(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n - 1 : 0;
+}
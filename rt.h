@@ -0,0 +1,29 @@
+/*
+ * About : Keeping a thread's timing steady, for deterministic latency.
+ *
+ * Notes :
+ *
+ * rt_lock_memory() locks everything the process has and will map into RAM
+ * and stops malloc from handing memory back to the system, so once the heap
+ * has been pre-faulted nothing on the hot path takes a page fault.
+ * rt_pin_thread() and rt_set_fifo() then keep the calling thread on one CPU
+ * and ahead of ordinary threads. All of them need privileges (CAP_IPC_LOCK,
+ * CAP_SYS_NICE or suitable rlimits) and return an errno value if refused,
+ * so callers can carry on without.
+ */
+
+#ifndef RT_H
+#define RT_H
+
+#include <stddef.h>
+
+#define RT_PRIORITY 50  /* SCHED_FIFO, between 1 and 99 */
+#define RT_HEAP_PREFAULT (16 << 20)
+
+int rt_lock_memory(size_t heap);
+int rt_pin_thread(int cpu);
+int rt_set_fifo(int priority);
+void rt_prefault(void * p, size_t length);
+int rt_last_cpu(void);
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * About : Nearest neighbour scaling of indexed frames.
+ */
+
+#ifndef SCALE_H
+#define SCALE_H
+
+#include <stdint.h>
+
+/* source coordinate for every destination row and column */
+typedef struct {
+    int src_w, src_h;
+    int dst_w, dst_h;
+    int * xmap;
+    int * ymap;
+} scale_map;
+
+int scale_init(scale_map * m, int src_w, int src_h, int dst_w, int dst_h);
+void scale_indexed(const scale_map * m, const uint8_t * src, uint8_t * dst);
+void scale_free(scale_map * m);
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * About : Driving one scope, see scope.h.
+ */
+
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "scope.h"
+#include "trace.h"
+
+/* returns 0 on success */
+int scope_open_model(scope_device * s, const char * dev,
+		     const scope_model * model) {
+    memset(s, 0, sizeof(*s));
+    s->model = model;
+    s->watch = -1;
+    if (strlen(dev) >= sizeof(s->dev)) {
+	return 1;
+    }
+    strcpy(s->dev, dev);
+    s->fd = serial_init(dev);
+    s->connected = s->fd != 0;
+    s->backoff = SCOPE_BACKOFF_MIN;
+    return !s->fd;
+}
+
+int scope_open(scope_device * s, const char * dev) {
+    return scope_open_model(s, dev, &scope_models[MODEL_DEFAULT]);
+}
+
+/*
+ * ask the scope what it is and use that model's layout from now on.
+ * returns 0 if it said and we know it, leaving the model alone otherwise.
+ */
+int scope_identify(scope_device * s) {
+    const scope_model * model;
+    char reply[128];
+
+    if (scope_command(s, "*IDN?", reply, sizeof(reply)) <= 0) {
+	return 1;
+    }
+    model = model_identify(reply);
+    if (!model) {
+	return 1;
+    }
+    s->model = model;
+    return 0;
+}
+
+/* close the port and schedule the next attempt to reopen it */
+static void scope_lost(scope_device * s, const struct timespec * now) {
+    if (s->fd) {
+	close(s->fd);
+	s->fd = 0;
+    }
+    s->connected = 0;
+    s->misses = 0;
+    s->retry = *now;
+    s->retry.tv_sec += s->backoff / 1000;
+    s->retry.tv_nsec += (s->backoff % 1000) * 1000000;
+    if (s->retry.tv_nsec >= 1000000000) {
+	s->retry.tv_nsec -= 1000000000;
+	s->retry.tv_sec++;
+    }
+    s->backoff = s->backoff * 2 < SCOPE_BACKOFF_MAX
+	? s->backoff * 2 : SCOPE_BACKOFF_MAX;
+}
+
+/*
+ * fetch a screen dump and decode it into s->indexed. returns 0 on success,
+ * leaving the last good frame in place otherwise. while the port is closed
+ * this returns 1 at once, unless it is time to try reopening it.
+ */
+int scope_capture(scope_device * s) {
+    struct timespec now;
+    int rv;
+
+    if (!s->connected) {
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec < s->retry.tv_sec || (now.tv_sec == s->retry.tv_sec
+					     && now.tv_nsec < s->retry.tv_nsec)) {
+	    return 1;
+	}
+	s->fd = serial_init(s->dev);
+	if (!s->fd) {
+	    scope_lost(s, &now);
+	    return 1;
+	}
+	tcflush(s->fd, TCIOFLUSH); /* whatever was in flight is stale */
+    }
+    rv = serial_acquire(s->fd, s->model->request, s->model->request_length,
+			s->dump, s->model->dump_size, s->seq + 1);
+    if (rv) {
+	s->failures++;
+	if (rv == SERIAL_GONE || !s->connected || ++s->misses >= SCOPE_MISSES) {
+	    clock_gettime(CLOCK_MONOTONIC, &now);
+	    scope_lost(s, &now);
+	}
+	return 1;
+    }
+    s->connected = 1;
+    s->misses = 0;
+    s->backoff = SCOPE_BACKOFF_MIN;
+    s->seq++;
+    TRACE(decode_start, s->seq);
+    s->model->decode(s->dump, s->indexed);
+    TRACE(decode_end, s->seq);
+    return 0;
+}
+
+/*
+ * send a command, a line of text without the newline. if reply is given,
+ * wait for the answer and store it there, NUL terminated. returns the reply
+ * length, or -1 on error.
+ */
+int scope_command(scope_device * s, const char * cmd, char * reply,
+		  size_t reply_max) {
+    uint8_t line[256];
+    size_t length = strlen(cmd);
+    int rv;
+
+    if (!s->connected || length + 1 > sizeof(line) || (reply && !reply_max)) {
+	return -1;
+    }
+    memcpy(line, cmd, length);
+    line[length++] = '\n';
+    rv = serial_command(s->fd, line, length, (uint8_t *) reply,
+			reply ? reply_max - 1 : 0, CMD_TIMEOUT);
+    if (reply && rv >= 0) {
+	reply[rv] = 0;
+    }
+    return rv;
+}
+
+/* let the next scope_capture() reopen the port straight away */
+void scope_retry(scope_device * s) {
+    if (!s->connected) {
+	s->retry.tv_sec = 0;
+	s->retry.tv_nsec = 0;
+	s->backoff = SCOPE_BACKOFF_MIN;
+    }
+}
+
+/*
+ * watch the directory holding the device node, so replugging the scope can
+ * be noticed without polling. returns a descriptor to wait on, or -1.
+ */
+int scope_watch(scope_device * s) {
+    char dir[sizeof(s->dev)];
+    char * slash;
+
+    if (s->watch != -1) {
+	return s->watch;
+    }
+    strcpy(dir, s->dev);
+    slash = strrchr(dir, '/');
+    if (!slash) {
+	strcpy(dir, ".");
+    } else if (slash == dir) {
+	dir[1] = 0;
+    } else {
+	*slash = 0;
+    }
+    s->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (s->watch == -1) {
+	return -1;
+    }
+    /* udev creates the node, then sets its owner and mode */
+    if (inotify_add_watch(s->watch, dir, IN_CREATE | IN_ATTRIB | IN_MOVED_TO)
+	== -1) {
+	close(s->watch);
+	s->watch = -1;
+    }
+    return s->watch;
+}
+
+/* read pending events, returns 1 if the scope's device node (re)appeared */
+int scope_watch_event(scope_device * s) {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event * e;
+    const char * name = strrchr(s->dev, '/');
+    ssize_t n;
+    char * p;
+    int seen = 0;
+
+    name = name ? name + 1 : s->dev;
+    while ((n = read(s->watch, buf, sizeof(buf))) > 0) {
+	for (p = buf; p < buf + n; p += sizeof(*e) + e->len) {
+	    e = (const struct inotify_event *) p;
+	    if (e->len && !strcmp(e->name, name)) {
+		seen = 1;
+	    }
+	}
+    }
+    return seen;
+}
+
+void scope_close(scope_device * s) {
+    if (s->fd) {
+	close(s->fd);
+	s->fd = 0;
+    }
+    if (s->watch != -1) {
+	close(s->watch);
+	s->watch = -1;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * About : libscopeview, everything needed to talk to a GDS-820C and turn
+ *         its screen dumps into pictures, without a GUI.
+ *
+ * Notes :
+ *
+ * All state lives in the structs passed in, so any number of scopes can be
+ * driven from any number of threads, one thread per struct at a time. The
+ * lower level modules (serial.h, decode.h, palette.h, pngwrite.h, shmring.h,
+ * client.h, record.h and friends) are part of the library too.
+ *
+ * A typical headless loop:
+ *
+ *     scope_device scope;
+ *     palette_lut lut;
+ *
+ *     scope_open(&scope, "/dev/ttyUSB0");
+ *     palette_lut_init(&lut, color_themes[0]);
+ *     while (!scope_capture(&scope)) {
+ *         palette_lut_indexed(&lut, scope.indexed, rgb, FRAME_PIXELS);
+ *         ...
+ *     }
+ *     scope_close(&scope);
+ *
+ * scope_open() assumes a GDS-820C. scope_open_model() takes another model
+ * from model.h, and scope_identify() asks the scope what it is.
+ *
+ * If the scope is unplugged or switched off, scope_capture() closes the port
+ * and from then on fails straight away, only reopening it after a delay that
+ * doubles with every failed attempt. scope_watch() gives a descriptor that
+ * becomes readable when device nodes come and go; when scope_watch_event()
+ * says the scope's one reappeared, scope_retry() makes the next capture try
+ * at once instead of waiting out the delay.
+ */
+
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "decode.h"
+#include "model.h"
+#include "palette.h"
+#include "serial.h"
+
+#define SCOPE_MISSES 3  /* dumps timed out in a row before reopening */
+#define SCOPE_BACKOFF_MIN 250  /* milliseconds before the first reopen */
+#define SCOPE_BACKOFF_MAX 8000
+
+typedef struct {
+    int fd;
+    const scope_model * model;
+    char dev[256];  /* to reopen it */
+    int connected;  /* 0 while waiting to reopen the port */
+    int misses;  /* failed dumps in a row */
+    long backoff;  /* milliseconds to wait after the next failed reopen */
+    struct timespec retry;  /* CLOCK_MONOTONIC time of the next reopen */
+    int watch;  /* inotify descriptor, or -1 */
+    uint64_t seq;  /* frames captured so far */
+    uint64_t failures;  /* screen dumps that didn't arrive whole */
+    uint8_t dump[MODEL_DUMP_MAX];  /* last screen dump as sent */
+    uint8_t indexed[FRAME_PIXELS];  /* the same, decoded */
+} scope_device;
+
+int scope_open(scope_device * s, const char * dev);
+int scope_open_model(scope_device * s, const char * dev,
+		     const scope_model * model);
+int scope_identify(scope_device * s);
+int scope_capture(scope_device * s);
+void scope_retry(scope_device * s);
+int scope_watch(scope_device * s);
+int scope_watch_event(scope_device * s);
+int scope_command(scope_device * s, const char * cmd, char * reply,
+		  size_t reply_max);
+void scope_close(scope_device * s);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * About : A pretend GDS-820C on a pseudo terminal, for testing without one.
+ *
+ * Notes :
+ *
+ * Prints the path of the pseudo terminal, then answers screen dump
+ * requests on it with a moving sine wave on channel 1 and a square wave on
+ * channel 2 over a graticule, each frame
+ * stamped with its number (see frameid.h). Lines starting with ':' or '*'
+ * are taken as commands, and queries (containing a '?') are answered.
+ *
+ * A real scope takes time to send 40 kB; -r limits the rate dumps go out
+ * at, and -d adds a delay before each one. With -l, the time every dump is
+ * asked for is logged, for scopetool latency.
+ *
+ * Usage : scopeemu [-r BYTES_PER_SECOND] [-d MS] [-l LOG]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "decode.h"
+#include "frameid.h"
+
+#define EMU_CHUNK 4096  /* bytes written at a time when rate limited */
+#define EMU_IDN "GW,GDS-820C,EMU,1.00\n"
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    stop = 1;
+}
+
+/* the picture for frame n */
+static void draw_frame(uint8_t * indexed, uint32_t n) {
+    int x, y;
+
+    for (y = 0; y < FRAME_HEIGHT; y++) {
+	for (x = 0; x < FRAME_WIDTH; x++) {
+	    indexed[y * FRAME_WIDTH + x] =
+		(x % 40 == 0 || y % 40 == 0) && (x + y) % 4 == 0 ? 1 : 0;
+	}
+    }
+    for (x = 0; x < FRAME_WIDTH; x++) {
+	y = FRAME_HEIGHT / 2 + (int) (80 * sin((x + 4 * n) * 2 * M_PI / 160));
+	indexed[y * FRAME_WIDTH + x] = 2; /* Channel-1, see palette.c */
+	y = FRAME_HEIGHT / 2 + ((x + 2 * n) % 50 < 25 ? -30 : 30);
+	indexed[y * FRAME_WIDTH + x] = 4; /* Channel-2 */
+    }
+    frameid_stamp(indexed, n);
+}
+
+static void sleep_ns(long long ns) {
+    struct timespec ts;
+
+    if (ns <= 0) {
+	return;
+    }
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    while (nanosleep(&ts, &ts) && errno == EINTR && !stop) {
+    }
+}
+
+static int write_all(int fd, const uint8_t * data, size_t length, long rate) {
+    size_t chunk;
+    ssize_t n;
+
+    while (length) {
+	chunk = rate && length > EMU_CHUNK ? EMU_CHUNK : length;
+	n = write(fd, data, chunk);
+	if (n < 0) {
+	    if (errno == EINTR && !stop) {
+		continue;
+	    }
+	    return 1;
+	}
+	data += n;
+	length -= n;
+	if (rate) {
+	    sleep_ns(n * 1000000000LL / rate);
+	}
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t indexed[FRAME_PIXELS];
+    static uint8_t dump[SCREEN_DUMP_SIZE];
+    static const uint8_t request[] = {0x57, 0x00, 0x00, 0x0A};
+    char buf[512], * nl;
+    size_t have = 0;
+    long rate = 0, delay_ms = 0;
+    uint32_t n = 0;
+    struct sigaction sa;
+    struct termios tio;
+    FILE * log = NULL;
+    ssize_t got;
+    int opt, fd;
+
+    while ((opt = getopt(argc, argv, "r:d:l:")) != -1) {
+	switch (opt) {
+	case 'r':
+	    rate = atol(optarg);
+	    break;
+	case 'd':
+	    delay_ms = atol(optarg);
+	    break;
+	case 'l':
+	    log = fopen(optarg, "w");
+	    if (!log) {
+		printf("error creating %s\n", optarg);
+		return 1;
+	    }
+	    break;
+	default:
+	    printf("usage: %s [-r BYTES_PER_SECOND] [-d MS] [-l LOG]\n",
+		   argv[0]);
+	    return 1;
+	}
+    }
+
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+	printf("error creating pseudo terminal\n");
+	return 1;
+    }
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    printf("%s\n", ptsname(fd));
+    fflush(stdout);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (!stop) {
+	got = read(fd, buf + have, sizeof(buf) - have);
+	if (got <= 0) {
+	    if (got < 0 && errno == EIO) {
+		sleep_ns(10000000); /* nobody has the terminal open yet */
+		continue;
+	    }
+	    if (got < 0 && errno == EINTR) {
+		continue;
+	    }
+	    break;
+	}
+	have += got;
+	while (have) {
+	    if (buf[0] == request[0]) {
+		if (have < sizeof(request)) {
+		    break;
+		}
+		if (memcmp(buf, request, sizeof(request))) {
+		    memmove(buf, buf + 1, --have);
+		    continue;
+		}
+		memmove(buf, buf + sizeof(request), have -= sizeof(request));
+		draw_frame(indexed, ++n);
+		if (log) {
+		    frameid_log(log, n);
+		}
+		encode_dump(indexed, dump);
+		sleep_ns(delay_ms * 1000000LL);
+		write_all(fd, dump, sizeof(dump), rate);
+	    } else if (buf[0] == ':' || buf[0] == '*') {
+		nl = memchr(buf, '\n', have);
+		if (!nl) {
+		    if (have == sizeof(buf)) {
+			have = 0; /* too long to be a command */
+		    }
+		    break;
+		}
+		if (memchr(buf, '?', nl - buf)) {
+		    write_all(fd, (const uint8_t *) EMU_IDN, strlen(EMU_IDN), 0);
+		}
+		have -= nl + 1 - buf;
+		memmove(buf, nl + 1, have);
+	    } else {
+		memmove(buf, buf + 1, --have);
+	    }
+	}
+    }
+    if (log) {
+	fclose(log);
+    }
+    close(fd);
+    return 0;
+}
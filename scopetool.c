@@ -0,0 +1,1506 @@
+/*
+ * About : Command line companion to scopeviewd.
+ *
+ * Usage : scopetool cmd [-c PATH] [-P low|normal|high] [-d MS] <command>
+ *
+ *         Send a command to the scope through the daemon and print the
+ *         reply, if the command is a query (contains a '?').
+ *
+ *         scopetool retheme <in.png> <theme> <out.png>
+ *
+ *         Give a snapshot saved by scopeview another color theme. Only the
+ *         palette is rewritten, the pixels are left alone.
+ *
+ *         scopetool record [-c PATH] [-n FRAMES] <out.svr>
+ *
+ *         Save frames served by the daemon to a recording, until FRAMES
+ *         have been saved or the tool is interrupted.
+ *
+ *         scopetool export [options] [in.svr]
+ *
+ *         Convert a recording, or the live frames served by the daemon if
+ *         none is given, to Y4M (the default) or raw RGB video on stdout,
+ *         e.g. for ffmpeg -i - out.mp4.
+ *
+ *         scopetool burst [-n FRAMES] <serial-device> <out.svr>
+ *
+ *         Capture FRAMES screen dumps back to back, straight from the serial
+ *         port (the daemon must not be running), into memory allocated up
+ *         front. Nothing is decoded or written until the burst is over, so
+ *         only the link limits the frame rate. Prints the distribution of
+ *         intervals between frames.
+ *
+ *         scopetool timelapse [-i SECONDS] [-m MB] <serial-device> <prefix>
+ *
+ *         Capture a screen dump every SECONDS, straight from the serial
+ *         port, keeping only frames that changed. They go to recordings
+ *         named prefix-YYYYmmdd-HHMMSS.svr, mostly as deltas, with an index
+ *         next to each. The oldest recordings are deleted to keep the total
+ *         under MB. The tool sleeps between captures.
+ *
+ *         scopetool at [-t THEME] <prefix|in.svr> "YYYY-mm-dd HH:MM:SS"
+ *                      <out.png>
+ *
+ *         Save what the scope showed at a given moment, from a time-lapse or
+ *         a recording, as a PNG.
+ *
+ *         scopetool similar [-b BITS] <ref.svr> <frame> <in.svr>...
+ *
+ *         List the frames in the recordings that look like the given frame
+ *         of ref.svr, most alike first, by comparing perceptual hashes.
+ *
+ *         scopetool find "<readout><op><value>" <in.svr>...
+ *
+ *         List the runs of frames whose readout (CH1, CH2, Time, Trig or
+ *         Freq) compares to value by op (=, <, <=, >, >=), e.g. "Freq<9.9kHz".
+ *         record and timelapse note the readouts as they go, given a font
+ *         (-F FILE, or readouts.font in the working directory), which
+ *         scopetool glyphs [-F FILE] <in.svr> <frame> helps to write.
+ *
+ *         scopetool latency <requests.log> <shown.log>...
+ *
+ *         Line up the times scopeemu -l logged frames being asked for with
+ *         the times scopeview --latency (or record -L) logged them being
+ *         shown, and print the distribution of request to photon latency
+ *         and how many frames never made it, for each log.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <glob.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "client.h"
+#include "export.h"
+#include "frameid.h"
+#include "palette.h"
+#include "phash.h"
+#include "pngwrite.h"
+#include "readout.h"
+#include "trend.h"
+#include "record.h"
+#include "serial.h"
+#include "stats.h"
+
+#define BURST_FRAMES 100
+#define BURST_MAX_FAILURES 10  /* give up after this many in a row */
+#define TIMELAPSE_INTERVAL 10  /* seconds between captures */
+#define TIMELAPSE_MAX_MB 256
+#define TIMELAPSE_SEGMENTS 8  /* the size limit is kept by deleting these */
+#define SIMILAR_DISTANCE 4  /* bits, of 64 */
+#define TREND_WIDTH 72  /* columns of plot */
+#define TREND_WIDTH_MAX 1024
+#define TREND_ROWS 16
+#define LATENCY_MAX_FRAMES (1 << 24)  /* days of frames, 128 MB of times */
+
+static const char * socket_path = PROTO_DEFAULT_SOCKET;
+static volatile sig_atomic_t stop;
+static readout_font font;
+static int have_font;
+
+void usage(const char * name) {
+    printf("usage: %s <tool> [options]\n", name);
+    printf("  cmd [-c PATH] [-P low|normal|high] [-d MS] <command>\n");
+    printf("  retheme <in.png> <theme|file.palette> <out.png>\n");
+    printf("  record [-c PATH] [-n FRAMES] [-F FILE] [-L LOG] <out.svr>\n");
+    printf("  burst [-n FRAMES] <serial-device> <out.svr>\n");
+    printf("  timelapse [-i SECONDS] [-m MB] [-F FILE] <serial-device>"
+	   " <prefix>\n");
+    printf("  at [-t THEME] <prefix|in.svr> \"YYYY-mm-dd HH:MM:SS\""
+	   " <out.png>\n");
+    printf("  similar [-b BITS] <ref.svr> <frame> <in.svr>...\n");
+    printf("  find \"<readout><op><value>\" <in.svr>...\n");
+    printf("  glyphs [-F FILE] <in.svr> <frame>\n");
+    printf("  trend [-c PATH] [-F FILE] [-w COLUMNS] [-s SECONDS] <readout>"
+	   " [in.svr]...\n");
+    printf("  latency <requests.log> <shown.log>...\n");
+    printf("  export [-f y4m|rgb] [-W WIDTH -H HEIGHT | -x SCALE] [-t THEME]"
+	   "\n         [-r FPS] [-j JOBS] [-c PATH] [-n FRAMES] [in.svr]\n");
+    printf("options:\n");
+    printf("  -c, --connect=PATH   scopeviewd socket (default %s)\n",
+	   PROTO_DEFAULT_SOCKET);
+    printf("  -P, --priority=PRIO  command queue priority (default normal)\n");
+    printf("  -d, --deadline=MS    give up unless started within MS\n");
+    printf("  -n, --frames=N       stop after N frames (burst: default %d)\n",
+	   BURST_FRAMES);
+    printf("  -f, --format=FORMAT  export y4m (4:4:4) or rgb (24 bit)\n");
+    printf("  -W, -H               export size (default 320x240)\n");
+    printf("  -x, --scale=N        export at N times the native size\n");
+    printf("  -t, --theme=NAME     color theme or palette file"
+	   " (default dark)\n");
+    printf("  -r, --fps=N          frame rate for the Y4M header (default 4)\n");
+    printf("  -j, --jobs=N         conversion threads (default: all cores)\n");
+    printf("  -i, --interval=S     seconds between time-lapse captures"
+	   " (default %d)\n", TIMELAPSE_INTERVAL);
+    printf("  -m, --max-size=MB    time-lapse disk budget (default %d)\n",
+	   TIMELAPSE_MAX_MB);
+    printf("  -F, --font=FILE      glyphs for reading readouts (default %s)\n",
+	   READOUT_DEFAULT_FONT);
+    printf("  -L, --latency=LOG    log when frames from scopeemu are recorded\n");
+    printf("  -b, --bits=N         how different similar frames may be"
+	   " (default %d)\n", SIMILAR_DISTANCE);
+    printf("  -w, --width=N        trend plot columns (default %d)\n",
+	   TREND_WIDTH);
+    printf("  -s, --seconds=N      trend over the last N seconds only\n");
+}
+
+static void on_signal(int sig) {
+    stop = 1;
+}
+
+/* let SIGINT and SIGTERM interrupt blocking reads instead of killing us */
+static void catch_signals(void) {
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+/* wait for the next frame from the daemon, 0 if interrupted or gone */
+static int next_live_frame(scope_client * c) {
+    int rv;
+
+    while (!stop) {
+	rv = client_recv(c);
+	if (rv < 0) {
+	    return 0;
+	}
+	if (rv == 1 && c->hdr.type == MSG_FRAME) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * load the font for recognizing readouts, from path or, if that is NULL,
+ * from READOUT_DEFAULT_FONT if there is one. returns nonzero on error.
+ */
+static int load_font(const char * path) {
+    if (readout_font_load(&font, path ? path : READOUT_DEFAULT_FONT)) {
+	have_font = 0;
+	if (path) {
+	    printf("error reading font %s\n", path);
+	    return 1;
+	}
+	return 0;
+    }
+    have_font = 1;
+    return 0;
+}
+
+/* note what the readouts of a frame say, if we can read them */
+static int log_readouts(readout_log * log, uint64_t seq, uint64_t timestamp,
+			const uint8_t * packed) {
+    static uint8_t indexed[FRAME_PIXELS];
+    char text[READOUT_FIELDS][READOUT_TEXT];
+
+    if (!log->f) {
+	return 0;
+    }
+    decode_unpack(packed, indexed);
+    readout_recognize(indexed, &font, text);
+    return readout_log_frame(log, seq, timestamp, text);
+}
+
+static int tool_cmd(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"connect", required_argument, NULL, 'c'},
+	{"priority", required_argument, NULL, 'P'},
+	{"deadline", required_argument, NULL, 'd'},
+	{NULL, 0, NULL, 0}};
+    static const char * status[] = {
+	"ok", "deadline expired", "no reply from scope", "daemon busy",
+	"invalid command"};
+    char cmd[CMD_MAX];
+    int flags = CMD_PRIO_NORMAL;
+    uint32_t deadline = 0;
+    scope_client c;
+    int opt, rv;
+
+    while ((opt = getopt_long(argc, argv, "c:P:d:", options, NULL)) != -1) {
+	switch (opt) {
+	case 'c':
+	    socket_path = optarg;
+	    break;
+	case 'P':
+	    if (!strcmp(optarg, "low")) {
+		flags = CMD_PRIO_LOW;
+	    } else if (!strcmp(optarg, "high")) {
+		flags = CMD_PRIO_HIGH;
+	    } else {
+		flags = CMD_PRIO_NORMAL;
+	    }
+	    break;
+	case 'd':
+	    deadline = atoi(optarg);
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind >= argc || strlen(argv[optind]) + 2 > sizeof(cmd)) {
+	return -1;
+    }
+    /* the scope wants each command terminated by a newline */
+    snprintf(cmd, sizeof(cmd), "%s\n", argv[optind]);
+    if (strchr(cmd, '?')) {
+	flags |= CMD_REPLY;
+    }
+
+    if (client_connect(&c, socket_path)) {
+	printf("error connecting to %s\n", socket_path);
+	return 1;
+    }
+    if (client_command(&c, 1, flags, deadline, cmd, strlen(cmd))) {
+	printf("error sending command\n");
+	return 1;
+    }
+    /* frames keep coming while we wait, skip them */
+    while ((rv = client_recv(&c)) == 1 && c.hdr.type != MSG_REPLY) {
+    }
+    client_close(&c);
+    if (rv != 1) {
+	printf("lost connection to %s\n", socket_path);
+	return 1;
+    }
+    if (c.hdr.flags != CMD_STATUS_OK) {
+	printf("error: %s\n", c.hdr.flags < 5 ? status[c.hdr.flags] : "?");
+	return 1;
+    }
+    fwrite(c.payload, 1, c.hdr.length, stdout);
+    return 0;
+}
+
+static int tool_retheme(int argc, char *argv[]) {
+    uint8_t * png = NULL;
+    size_t length = 0;
+    long size;
+    FILE * f;
+    int t, rv = 1;
+
+    if (argc != 4 || (t = palette_select(argv[2])) < 0) {
+	return -1;
+    }
+    f = fopen(argv[1], "rb");
+    if (!f) {
+	printf("error opening %s\n", argv[1]);
+	return 1;
+    }
+    if (!fseek(f, 0, SEEK_END) && (size = ftell(f)) > 0
+	&& !fseek(f, 0, SEEK_SET) && (png = malloc(size))) {
+	length = fread(png, 1, size, f);
+    }
+    fclose(f);
+    f = NULL;
+
+    if (!png || png_set_palette(png, length, color_themes[t])) {
+	printf("%s is not a scopeview snapshot\n", argv[1]);
+    } else if (!(f = fopen(argv[3], "wb"))
+	       || fwrite(png, 1, length, f) != length) {
+	printf("error writing %s\n", argv[3]);
+    } else {
+	rv = 0;
+    }
+    if (f) {
+	fclose(f);
+    }
+    free(png);
+    return rv;
+}
+
+static int tool_record(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"connect", required_argument, NULL, 'c'},
+	{"frames", required_argument, NULL, 'n'},
+	{"font", required_argument, NULL, 'F'},
+	{"latency", required_argument, NULL, 'L'},
+	{NULL, 0, NULL, 0}};
+    const char * font_path = NULL;
+    FILE * latency_log = NULL;
+    uint64_t limit = 0;
+    static uint8_t indexed[FRAME_PIXELS];
+    readout_log text;
+    scope_client c;
+    recording r;
+    uint32_t id;
+    int opt, rv = 0;
+
+    while ((opt = getopt_long(argc, argv, "c:n:F:L:", options, NULL))
+	   != -1) {
+	switch (opt) {
+	case 'L':
+	    latency_log = fopen(optarg, "w");
+	    if (!latency_log) {
+		printf("error creating %s\n", optarg);
+		return 1;
+	    }
+	    break;
+	case 'c':
+	    socket_path = optarg;
+	    break;
+	case 'n':
+	    limit = strtoull(optarg, NULL, 10);
+	    break;
+	case 'F':
+	    font_path = optarg;
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 1 != argc) {
+	return -1;
+    }
+    if (load_font(font_path)) {
+	return 1;
+    }
+    if (client_connect(&c, socket_path)) {
+	printf("error connecting to %s\n", socket_path);
+	return 1;
+    }
+    memset(&text, 0, sizeof(text));
+    if (record_create_indexed(&r, argv[optind])
+	|| (have_font && readout_log_open(&text, argv[optind]))) {
+	printf("error creating %s\n", argv[optind]);
+	client_close(&c);
+	record_close(&r);
+	return 1;
+    }
+
+    catch_signals();
+    while ((!limit || r.frames < limit) && next_live_frame(&c)) {
+	if (record_write(&r, c.hdr.seq, c.hdr.timestamp, c.payload)
+	    || log_readouts(&text, c.hdr.seq, c.hdr.timestamp, c.payload)) {
+	    rv = 1;
+	    break;
+	}
+	if (latency_log) {
+	    decode_unpack(c.payload, indexed);
+	    if (!frameid_read(indexed, &id)) {
+		frameid_log(latency_log, id);
+	    }
+	}
+    }
+    if (latency_log) {
+	fclose(latency_log);
+    }
+    client_close(&c);
+    printf("recorded %llu frames\n", (unsigned long long) r.frames);
+    if (record_close(&r) | readout_log_close(&text) || rv) {
+	printf("error writing %s\n", argv[optind]);
+	return 1;
+    }
+    return 0;
+}
+
+struct export_input {
+    recording r;
+    scope_client c;
+    int live;
+    uint64_t limit;
+    uint64_t count;
+};
+
+static int export_next(void * ctx, uint8_t * packed) {
+    struct export_input * in = ctx;
+    struct record_header hdr;
+    int rv;
+
+    if (in->limit && in->count == in->limit) {
+	return 0;
+    }
+    if (in->live) {
+	rv = next_live_frame(&in->c);
+	if (rv) {
+	    memcpy(packed, in->c.payload, FRAME_PACKED_SIZE);
+	}
+    } else {
+	rv = record_read(&in->r, &hdr, packed);
+    }
+    in->count += rv == 1;
+    return rv;
+}
+
+static int tool_export(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"connect", required_argument, NULL, 'c'},
+	{"frames", required_argument, NULL, 'n'},
+	{"format", required_argument, NULL, 'f'},
+	{"scale", required_argument, NULL, 'x'},
+	{"theme", required_argument, NULL, 't'},
+	{"fps", required_argument, NULL, 'r'},
+	{"jobs", required_argument, NULL, 'j'},
+	{NULL, 0, NULL, 0}};
+    export_options opt;
+    struct export_input in;
+    uint64_t frames;
+    int o, theme = 0, scale = 1, rv;
+
+    memset(&opt, 0, sizeof(opt));
+    memset(&in, 0, sizeof(in));
+    opt.format = EXPORT_Y4M;
+    opt.fps = 4;
+    opt.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    opt.out = stdout;
+    while ((o = getopt_long(argc, argv, "c:n:f:W:H:x:t:r:j:", options, NULL))
+	   != -1) {
+	switch (o) {
+	case 'c':
+	    socket_path = optarg;
+	    break;
+	case 'n':
+	    in.limit = strtoull(optarg, NULL, 10);
+	    break;
+	case 'f':
+	    if (!strcmp(optarg, "rgb")) {
+		opt.format = EXPORT_RGB;
+	    } else if (strcmp(optarg, "y4m")) {
+		return -1;
+	    }
+	    break;
+	case 'W':
+	    opt.width = atoi(optarg);
+	    break;
+	case 'H':
+	    opt.height = atoi(optarg);
+	    break;
+	case 'x':
+	    scale = atoi(optarg);
+	    break;
+	case 't':
+	    theme = palette_select(optarg);
+	    break;
+	case 'r':
+	    opt.fps = atoi(optarg);
+	    break;
+	case 'j':
+	    opt.jobs = atoi(optarg);
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (!opt.width || !opt.height) {
+	opt.width = FRAME_WIDTH * scale;
+	opt.height = FRAME_HEIGHT * scale;
+    }
+    if (optind + 1 < argc || theme < 0 || scale < 1 || opt.width < 1
+	|| opt.height < 1 || opt.fps < 1) {
+	return -1;
+    }
+    if (opt.jobs < 1) {
+	opt.jobs = 1;
+    }
+    opt.colors = color_themes[theme];
+
+    /* stdout carries the video, so messages go to stderr here */
+    in.live = optind == argc;
+    if (in.live && client_connect(&in.c, socket_path)) {
+	fprintf(stderr, "error connecting to %s\n", socket_path);
+	return 1;
+    }
+    if (!in.live && record_open(&in.r, argv[optind])) {
+	fprintf(stderr, "error opening recording %s\n", argv[optind]);
+	return 1;
+    }
+
+    catch_signals();
+    rv = export_run(&opt, export_next, &in, &frames);
+    if (in.live) {
+	client_close(&in.c);
+    } else {
+	record_close(&in.r);
+    }
+    fprintf(stderr, "exported %llu frames\n", (unsigned long long) frames);
+    return rv;
+}
+
+static double ms_between(const struct timespec * a, const struct timespec * b) {
+    return (b->tv_sec - a->tv_sec) * 1e3 + (b->tv_nsec - a->tv_nsec) / 1e6;
+}
+
+static int tool_burst(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"frames", required_argument, NULL, 'n'},
+	{NULL, 0, NULL, 0}};
+    static uint8_t indexed[FRAME_PIXELS];
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    struct timespec real0, mono0, * done;
+    uint8_t * dumps;
+    double * intervals;
+    int opt, fd, i, frames = BURST_FRAMES, captured = 0;
+    int failures = 0, failed_in_row = 0, rv = 0;
+    uint64_t ts;
+    recording r;
+
+    while ((opt = getopt_long(argc, argv, "n:", options, NULL)) != -1) {
+	switch (opt) {
+	case 'n':
+	    frames = atoi(optarg);
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 2 != argc || frames < 1) {
+	return -1;
+    }
+
+    /* allocate and touch everything now, not during the burst */
+    dumps = malloc((size_t) frames * SCREEN_DUMP_SIZE);
+    done = calloc(frames, sizeof(struct timespec));
+    intervals = calloc(frames, sizeof(double));
+    if (!dumps || !done || !intervals) {
+	printf("not enough memory for %d frames\n", frames);
+	free(dumps);
+	free(done);
+	free(intervals);
+	return 1;
+    }
+    memset(dumps, 0, (size_t) frames * SCREEN_DUMP_SIZE);
+
+    /* a bad output path should not cost a whole burst */
+    if (record_create(&r, argv[optind + 1])) {
+	printf("error creating %s\n", argv[optind + 1]);
+	rv = 1;
+	goto out;
+    }
+
+    fd = serial_init(argv[optind]);
+    if (!fd) {
+	printf("error opening serial port\n");
+	record_close(&r);
+	unlink(argv[optind + 1]);
+	rv = 1;
+	goto out;
+    }
+
+    catch_signals();
+    clock_gettime(CLOCK_REALTIME, &real0);
+    clock_gettime(CLOCK_MONOTONIC, &mono0);
+    while (captured < frames && !stop
+	   && failed_in_row < BURST_MAX_FAILURES) {
+	if (acquire_scope_buffer(fd, dumps + (size_t) captured
+				 * SCREEN_DUMP_SIZE, captured + 1)) {
+	    failures++;
+	    failed_in_row++;
+	    continue;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &done[captured++]);
+	failed_in_row = 0;
+    }
+    close(fd);
+
+    /* burst is over, now there is time to decode and write */
+    for (i = 0; i < captured && !rv; i++) {
+	decode_indexed(dumps + (size_t) i * SCREEN_DUMP_SIZE, indexed);
+	decode_pack(indexed, packed);
+	ts = (uint64_t) real0.tv_sec * 1000000 + real0.tv_nsec / 1000
+	    + (uint64_t) (ms_between(&mono0, &done[i]) * 1000);
+	rv = record_write(&r, i + 1, ts, packed);
+    }
+    if (record_close(&r) || rv) {
+	printf("error writing %s\n", argv[optind + 1]);
+	rv = 1;
+    }
+
+    printf("%d frames in %.3f s, %d failed transfers\n", captured,
+	   captured ? ms_between(&mono0, &done[captured - 1]) / 1e3 : 0.0,
+	   failures);
+    for (i = 1; i < captured; i++) {
+	intervals[i - 1] = ms_between(&done[i - 1], &done[i]);
+    }
+    stats_report(stdout, "inter-frame interval", "ms", intervals,
+		 captured - 1);
+
+out:
+    free(dumps);
+    free(done);
+    free(intervals);
+    return rv;
+}
+
+/* all segments of a time-lapse, oldest first, in g. returns 0 on success */
+static int timelapse_segments(const char * prefix, glob_t * g) {
+    char pattern[4096];
+
+    snprintf(pattern, sizeof(pattern), "%s-*.svr", prefix);
+    return glob(pattern, 0, NULL, g) != 0;
+}
+
+static off_t file_size(const char * path) {
+    struct stat st;
+
+    return stat(path, &st) ? 0 : st.st_size;
+}
+
+/* a recording and the files kept next to it */
+static const char * segment_files[] = {"", ".idx", ".phash", ".text"};
+#define SEGMENT_FILES (sizeof(segment_files) / sizeof(segment_files[0]))
+
+static off_t segment_size(const char * path, int remove) {
+    char file[4096];
+    off_t size = 0;
+    size_t i;
+
+    for (i = 0; i < SEGMENT_FILES; i++) {
+	snprintf(file, sizeof(file), "%s%s", path, segment_files[i]);
+	size += file_size(file);
+	if (remove) {
+	    unlink(file);
+	}
+    }
+    return size;
+}
+
+/* delete the oldest segments, but never the current one, until under max */
+static void timelapse_trim(const char * prefix, const char * current,
+			   off_t max) {
+    off_t total = 0;
+    glob_t g;
+    size_t i;
+
+    if (timelapse_segments(prefix, &g)) {
+	return;
+    }
+    for (i = 0; i < g.gl_pathc; i++) {
+	total += segment_size(g.gl_pathv[i], 0);
+    }
+    for (i = 0; i < g.gl_pathc && total > max; i++) {
+	if (!strcmp(g.gl_pathv[i], current)) {
+	    break;
+	}
+	total -= segment_size(g.gl_pathv[i], 1);
+    }
+    globfree(&g);
+}
+
+static int tool_timelapse(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"interval", required_argument, NULL, 'i'},
+	{"max-size", required_argument, NULL, 'm'},
+	{"font", required_argument, NULL, 'F'},
+	{NULL, 0, NULL, 0}};
+    static uint8_t dump[SCREEN_DUMP_SIZE];
+    static uint8_t indexed[FRAME_PIXELS];
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    static uint8_t last[FRAME_PACKED_SIZE];
+    char path[4096] = "", name[4096];
+    struct timespec next, now;
+    struct tm tm;
+    double interval = TIMELAPSE_INTERVAL;
+    off_t max = (off_t) TIMELAPSE_MAX_MB << 20;
+    uint64_t seq = 0, stored = 0, ts;
+    int opt, fd, have_last = 0, open = 0, rv = 0;
+    const char * font_path = NULL;
+    readout_log text;
+    recording r;
+
+    while ((opt = getopt_long(argc, argv, "i:m:F:", options, NULL)) != -1) {
+	switch (opt) {
+	case 'F':
+	    font_path = optarg;
+	    break;
+	case 'i':
+	    interval = atof(optarg);
+	    break;
+	case 'm':
+	    max = (off_t) (atof(optarg) * (1 << 20));
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 2 != argc || interval <= 0
+	|| max < TIMELAPSE_SEGMENTS * (off_t) FRAME_PACKED_SIZE * 2) {
+	return -1;
+    }
+    if (load_font(font_path)) {
+	return 1;
+    }
+    memset(&text, 0, sizeof(text));
+    fd = serial_init(argv[optind]);
+    if (!fd) {
+	printf("error opening serial port\n");
+	return 1;
+    }
+
+    catch_signals();
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!stop) {
+	if (!acquire_scope_buffer(fd, dump, seq + 1)) {
+	    seq++;
+	    decode_indexed(dump, indexed);
+	    decode_pack(indexed, packed);
+	}
+	/* a scope left alone shows the same screen for hours */
+	if (seq && (!have_last || memcmp(packed, last, FRAME_PACKED_SIZE))) {
+	    memcpy(last, packed, FRAME_PACKED_SIZE);
+	    have_last = 1;
+	    clock_gettime(CLOCK_REALTIME, &now);
+	    localtime_r(&now.tv_sec, &tm);
+	    snprintf(name, sizeof(name), "%s-", argv[optind + 1]);
+	    strftime(name + strlen(name), sizeof(name) - strlen(name),
+		     "%Y%m%d-%H%M%S.svr", &tm);
+	    /* start another segment when this one has its share of the disk */
+	    if (open && ftell(r.f) > max / TIMELAPSE_SEGMENTS
+		&& strcmp(name, path)) {
+		rv = record_close(&r) | readout_log_close(&text);
+		open = 0;
+	    }
+	    if (!open && !rv) {
+		strcpy(path, name);
+		rv = record_create_indexed(&r, path)
+		    || (have_font && readout_log_open(&text, path));
+		open = !rv;
+	    }
+	    ts = (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+	    if (rv || record_append(&r, seq, ts, packed)
+		|| log_readouts(&text, seq, ts, packed)) {
+		printf("error writing %s\n", path);
+		rv = 1;
+		break;
+	    }
+	    stored++;
+	    timelapse_trim(argv[optind + 1], path, max);
+	}
+
+	/* sleep until the next capture is due, skipping any we overran */
+	next.tv_sec += (time_t) interval;
+	next.tv_nsec += (long) ((interval - (time_t) interval) * 1e9);
+	if (next.tv_nsec >= 1000000000) {
+	    next.tv_sec++;
+	    next.tv_nsec -= 1000000000;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (next.tv_sec < now.tv_sec) {
+	    next = now;
+	}
+	while (!stop && clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next,
+					NULL) == EINTR) {
+	}
+    }
+    close(fd);
+    if (open && (record_close(&r) | readout_log_close(&text))) {
+	printf("error writing %s\n", path);
+	rv = 1;
+    }
+    printf("%llu captures, %llu changed frames stored\n",
+	   (unsigned long long) seq, (unsigned long long) stored);
+    return rv;
+}
+
+/* first frame time of a recording, 0 if it has none */
+static uint64_t first_timestamp(const char * path) {
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    struct record_header hdr;
+    recording r;
+    uint64_t ts = 0;
+
+    if (!record_open(&r, path)) {
+	if (record_read(&r, &hdr, packed) == 1) {
+	    ts = hdr.timestamp;
+	}
+	record_close(&r);
+    }
+    return ts;
+}
+
+static int tool_at(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"theme", required_argument, NULL, 't'},
+	{NULL, 0, NULL, 0}};
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    static uint8_t found[FRAME_PACKED_SIZE];
+    struct record_header hdr;
+    const char * path = NULL;
+    struct tm tm;
+    uint64_t when, found_ts = 0, ts;
+    uint8_t * png;
+    size_t i, length;
+    int opt, theme = 0, rv = 1;
+    char stamp[64];
+    time_t t;
+    recording r;
+    glob_t g;
+    FILE * f;
+
+    while ((opt = getopt_long(argc, argv, "t:", options, NULL)) != -1) {
+	switch (opt) {
+	case 't':
+	    theme = palette_select(optarg);
+	    if (theme < 0) {
+		return -1;
+	    }
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 3 != argc) {
+	return -1;
+    }
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(argv[optind + 1], "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon,
+	       &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+	return -1;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    when = (uint64_t) mktime(&tm) * 1000000 + 999999;
+
+    /* a single recording, or the last segment starting before the moment */
+    memset(&g, 0, sizeof(g));
+    if (file_size(argv[optind]) > 0) {
+	path = argv[optind];
+    } else if (!timelapse_segments(argv[optind], &g)) {
+	for (i = 0; i < g.gl_pathc; i++) {
+	    ts = first_timestamp(g.gl_pathv[i]);
+	    if (ts && ts <= when) {
+		path = g.gl_pathv[i];
+	    }
+	}
+    }
+    if (!path || record_open(&r, path)) {
+	printf("no recording of %s\n", argv[optind + 1]);
+	globfree(&g);
+	return 1;
+    }
+
+    record_seek(&r, path, when);
+    while (record_read(&r, &hdr, packed) == 1 && hdr.timestamp <= when) {
+	memcpy(found, packed, FRAME_PACKED_SIZE);
+	found_ts = hdr.timestamp;
+    }
+    record_close(&r);
+    if (!found_ts) {
+	printf("no recording of %s\n", argv[optind + 1]);
+    } else if (png_encode_packed(found, FRAME_WIDTH, FRAME_HEIGHT,
+				 color_themes[theme], &png, &length)) {
+	printf("error encoding %s\n", argv[optind + 2]);
+    } else {
+	if (!(f = fopen(argv[optind + 2], "wb"))
+	    || fwrite(png, 1, length, f) != length) {
+	    printf("error writing %s\n", argv[optind + 2]);
+	} else {
+	    t = found_ts / 1000000;
+	    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S",
+		     localtime_r(&t, &tm));
+	    printf("%s: frame captured %s from %s\n", argv[optind + 2], stamp,
+		   path);
+	    rv = 0;
+	}
+	if (f) {
+	    fclose(f);
+	}
+	free(png);
+    }
+    globfree(&g);
+    return rv;
+}
+
+struct hash_set {
+    struct phash_entry * entries;
+    uint64_t * hashes;
+    int * file;
+    size_t count, size;
+};
+
+/*
+ * add the hashes of a recording to set, from the file next to it, or by
+ * reading the recording if there is none (which then saves one)
+ */
+static int load_hashes(struct hash_set * set, const char * path, int file) {
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    static uint8_t indexed[FRAME_PIXELS];
+    struct phash_entry entry;
+    struct record_header hdr;
+    char hash_path[4096];
+    FILE * f, * out;
+    recording r;
+    int rv;
+
+    snprintf(hash_path, sizeof(hash_path), "%s.phash", path);
+    f = fopen(hash_path, "rb");
+    if (!f && record_open(&r, path)) {
+	return 1;
+    }
+    out = f ? NULL : fopen(hash_path, "wb");
+    while (1) {
+	if (f) {
+	    if (fread(&entry, sizeof(entry), 1, f) != 1) {
+		break;
+	    }
+	} else {
+	    if ((rv = record_read(&r, &hdr, packed)) != 1) {
+		break;
+	    }
+	    decode_unpack(packed, indexed);
+	    entry.hash = phash_indexed(indexed);
+	    entry.seq = hdr.seq;
+	    entry.timestamp = hdr.timestamp;
+	    if (out) {
+		fwrite(&entry, sizeof(entry), 1, out);
+	    }
+	}
+	if (set->count == set->size) {
+	    set->size = set->size ? set->size * 2 : 4096;
+	    set->entries = realloc(set->entries,
+				   set->size * sizeof(*set->entries));
+	    set->hashes = realloc(set->hashes, set->size * sizeof(uint64_t));
+	    set->file = realloc(set->file, set->size * sizeof(int));
+	    if (!set->entries || !set->hashes || !set->file) {
+		printf("out of memory\n");
+		exit(1);
+	    }
+	}
+	set->entries[set->count] = entry;
+	set->hashes[set->count] = entry.hash;
+	set->file[set->count++] = file;
+    }
+    if (f) {
+	fclose(f);
+    } else {
+	record_close(&r);
+	if (out && (fclose(out) || rv < 0)) {
+	    unlink(hash_path); /* don't leave half of one behind */
+	}
+    }
+    return 0;
+}
+
+struct similar_match {
+    size_t id;
+    int distance;
+};
+
+struct similar_results {
+    struct similar_match * matches;
+    size_t count;
+};
+
+static void similar_found(void * ctx, size_t id, int distance) {
+    struct similar_results * res = ctx;
+
+    res->matches[res->count].id = id;
+    res->matches[res->count++].distance = distance;
+}
+
+static int compare_matches(const void * a, const void * b) {
+    const struct similar_match * x = a, * y = b;
+
+    if (x->distance != y->distance) {
+	return x->distance - y->distance;
+    }
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static int tool_similar(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"bits", required_argument, NULL, 'b'},
+	{NULL, 0, NULL, 0}};
+    struct hash_set set = {NULL, NULL, NULL, 0, 0};
+    struct similar_results res;
+    struct timespec t0, t1;
+    struct phash_entry * e;
+    int opt, i, radius = SIMILAR_DISTANCE, found = 0;
+    uint64_t seq, hash = 0;
+    phash_index ix;
+    size_t j;
+    struct tm tm;
+    time_t t;
+    char stamp[64];
+
+    while ((opt = getopt_long(argc, argv, "b:", options, NULL)) != -1) {
+	switch (opt) {
+	case 'b':
+	    radius = atoi(optarg);
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 3 > argc || radius < 0) {
+	return -1;
+    }
+    seq = strtoull(argv[optind + 1], NULL, 10);
+
+    /* the reference frame's hash */
+    if (load_hashes(&set, argv[optind], 0)) {
+	printf("error reading %s\n", argv[optind]);
+	return 1;
+    }
+    for (j = 0; j < set.count && !found; j++) {
+	if (set.entries[j].seq == seq) {
+	    hash = set.hashes[j];
+	    found = 1;
+	}
+    }
+    if (!found) {
+	printf("no frame %llu in %s\n", (unsigned long long) seq,
+	       argv[optind]);
+	return 1;
+    }
+    set.count = 0;
+
+    for (i = optind + 2; i < argc; i++) {
+	if (load_hashes(&set, argv[i], i)) {
+	    printf("error reading %s\n", argv[i]);
+	}
+    }
+    res.matches = malloc((set.count ? set.count : 1) * sizeof(*res.matches));
+    res.count = 0;
+    if (!res.matches || phash_index_build(&ix, set.hashes, set.count)) {
+	printf("out of memory\n");
+	return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    phash_index_query(&ix, hash, radius, similar_found, &res);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    qsort(res.matches, res.count, sizeof(*res.matches), compare_matches);
+
+    for (j = 0; j < res.count; j++) {
+	e = &set.entries[res.matches[j].id];
+	t = e->timestamp / 1000000;
+	strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S",
+		 localtime_r(&t, &tm));
+	printf("%2d  %s  %s  frame %llu\n", res.matches[j].distance, stamp,
+	       argv[set.file[res.matches[j].id]], (unsigned long long) e->seq);
+    }
+    fprintf(stderr, "%zu of %zu frames within %d bits, found in %.3f ms\n",
+	    res.count, set.count, radius, ms_between(&t0, &t1));
+
+    phash_index_free(&ix);
+    free(res.matches);
+    free(set.entries);
+    free(set.hashes);
+    free(set.file);
+    return 0;
+}
+
+static int tool_glyphs(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"font", required_argument, NULL, 'F'},
+	{NULL, 0, NULL, 0}};
+    static uint8_t packed[FRAME_PACKED_SIZE];
+    static uint8_t indexed[FRAME_PIXELS];
+    struct record_header hdr;
+    const char * font_path = NULL;
+    uint64_t seq;
+    recording r;
+    int opt, rv;
+
+    while ((opt = getopt_long(argc, argv, "F:", options, NULL)) != -1) {
+	switch (opt) {
+	case 'F':
+	    font_path = optarg;
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind + 2 != argc) {
+	return -1;
+    }
+    if (load_font(font_path)) {
+	return 1;
+    }
+    seq = strtoull(argv[optind + 1], NULL, 10);
+    if (record_open(&r, argv[optind])) {
+	printf("error reading %s\n", argv[optind]);
+	return 1;
+    }
+    while ((rv = record_read(&r, &hdr, packed)) == 1 && hdr.seq != seq) {
+    }
+    record_close(&r);
+    if (rv != 1) {
+	printf("no frame %llu in %s\n", (unsigned long long) seq,
+	       argv[optind]);
+	return 1;
+    }
+    decode_unpack(packed, indexed);
+    readout_glyphs(stdout, indexed, &font);
+    return 0;
+}
+
+static void print_run(const char * path, const struct readout_run * run) {
+    char first[64], last[64];
+    struct tm tm;
+    time_t t;
+
+    t = run->first_timestamp / 1000000;
+    strftime(first, sizeof(first), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+    t = run->last_timestamp / 1000000;
+    strftime(last, sizeof(last), "%H:%M:%S", localtime_r(&t, &tm));
+    printf("%s  frames %llu-%llu  %s - %s  %s\n", path,
+	   (unsigned long long) run->first_seq,
+	   (unsigned long long) run->last_seq, first, last, run->text);
+}
+
+static int tool_find(int argc, char *argv[]) {
+    static const char * ops[] = {"<=", ">=", "<", ">", "="};
+    const char * query, * op = NULL, * value;
+    double number, low = -INFINITY, high = INFINITY;
+    size_t i, first, count, total = 0;
+    int field, numeric, o;
+    readout_index ix;
+
+    if (argc < 3) {
+	return -1;
+    }
+    query = argv[1];
+    for (o = 0; o < 5 && !op; o++) {
+	op = strstr(query, ops[o]) ? ops[o] : NULL;
+    }
+    if (!op) {
+	return -1;
+    }
+    value = strstr(query, op) + strlen(op);
+    for (field = 0; field < READOUT_FIELDS; field++) {
+	if (!strncasecmp(query, readout_names[field], strlen(readout_names[field]))
+	    && query + strlen(readout_names[field]) == strstr(query, op)) {
+	    break;
+	}
+    }
+    if (field == READOUT_FIELDS) {
+	printf("readouts are CH1, CH2, Time, Trig and Freq\n");
+	return 1;
+    }
+    numeric = !readout_number(value, &number);
+    if (!numeric && op[0] != '=') {
+	printf("%s is not a number\n", value);
+	return 1;
+    }
+    if (op[0] == '<') {
+	high = op[1] ? number : nextafter(number, -INFINITY);
+    } else if (op[0] == '>') {
+	low = op[1] ? number : nextafter(number, INFINITY);
+    } else {
+	low = high = number;
+    }
+
+    for (i = 2; i < (size_t) argc; i++) {
+	if (readout_index_load(&ix, argv[i])) {
+	    printf("no readouts recorded for %s\n", argv[i]);
+	    continue;
+	}
+	if (numeric) {
+	    count = readout_index_range(&ix, field, low, high, &first);
+	} else {
+	    count = readout_index_text(&ix, field, value, &first);
+	}
+	for (o = 0; (size_t) o < count; o++) {
+	    print_run(argv[i], numeric ? ix.by_number[first + o]
+		      : ix.by_text[first + o]);
+	}
+	total += count;
+	readout_index_free(&ix);
+    }
+    return total == 0;
+}
+
+/* the readout field called name, or -1 */
+static int readout_field(const char * name) {
+    int field;
+
+    for (field = 0; field < READOUT_FIELDS; field++) {
+	if (!strcasecmp(name, readout_names[field])) {
+	    return field;
+	}
+    }
+    return -1;
+}
+
+/* plot the series as text, the last seconds of it or all if that's 0 */
+static void draw_trend(const trend_series * s, int field, int columns,
+		       uint64_t seconds, int live) {
+    static double min[TREND_WIDTH_MAX], max[TREND_WIDTH_MAX];
+    char line[TREND_WIDTH_MAX + 1], first[32], last[32];
+    double low = INFINITY, high = -INFINITY, top, bottom;
+    uint64_t t0, t1;
+    struct tm tm;
+    time_t t;
+    int c, row;
+
+    if (live) {
+	printf("\033[H\033[J");
+    }
+    if (!s->count[0]) {
+	printf("%s: no readings yet\n", readout_names[field]);
+	fflush(stdout);
+	return;
+    }
+    t0 = s->level[0][0].first;
+    t1 = s->level[0][s->count[0] - 1].last;
+    if (seconds && t1 - t0 > seconds * 1000000) {
+	t0 = t1 - seconds * 1000000;
+    }
+    trend_plot(s, t0, t1, columns, min, max);
+    for (c = 0; c < columns; c++) {
+	low = min[c] < low ? min[c] : low;
+	high = max[c] > high ? max[c] : high;
+    }
+    if (high == low) {
+	low -= fabs(low) * 0.01 + 1e-12;
+	high += fabs(high) * 0.01 + 1e-12;
+    }
+    for (row = 0; row < TREND_ROWS; row++) {
+	top = high - (high - low) * row / TREND_ROWS;
+	bottom = high - (high - low) * (row + 1) / TREND_ROWS;
+	for (c = 0; c < columns; c++) {
+	    line[c] = max[c] >= bottom && min[c] <= top ? '#' : ' ';
+	}
+	line[columns] = 0;
+	if (row == 0 || row == TREND_ROWS - 1) {
+	    printf("%10.4g |%s\n", row ? low : high, line);
+	} else {
+	    printf("%10s |%s\n", "", line);
+	}
+    }
+    t = t0 / 1000000;
+    strftime(first, sizeof(first), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm));
+    t = t1 / 1000000;
+    strftime(last, sizeof(last), "%H:%M:%S", localtime_r(&t, &tm));
+    printf("%10s  %s - %s  %s now %.4g\n", "", first, last,
+	   readout_names[field], s->level[0][s->count[0] - 1].max);
+    fflush(stdout);
+}
+
+/*
+ * plot a readout over time, from the readouts recorded with recordings or,
+ * without any, live from the daemon, redrawn as each frame comes in
+ */
+static int tool_trend(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"connect", required_argument, NULL, 'c'},
+	{"font", required_argument, NULL, 'F'},
+	{"width", required_argument, NULL, 'w'},
+	{"seconds", required_argument, NULL, 's'},
+	{NULL, 0, NULL, 0}};
+    static uint8_t indexed[FRAME_PIXELS];
+    char text[READOUT_FIELDS][READOUT_TEXT];
+    const char * font_path = NULL;
+    trend_series s;
+    uint64_t seconds = 0;
+    readout_index ix;
+    scope_client c;
+    int opt, field, columns = TREND_WIDTH, i, rv = 0;
+    double number;
+    size_t k;
+
+    while ((opt = getopt_long(argc, argv, "c:F:w:s:", options, NULL))
+	   != -1) {
+	switch (opt) {
+	case 'c':
+	    socket_path = optarg;
+	    break;
+	case 'F':
+	    font_path = optarg;
+	    break;
+	case 'w':
+	    columns = atoi(optarg);
+	    break;
+	case 's':
+	    seconds = strtoull(optarg, NULL, 10);
+	    break;
+	default:
+	    return -1;
+	}
+    }
+    if (optind >= argc || columns < 1 || columns > TREND_WIDTH_MAX) {
+	return -1;
+    }
+    field = readout_field(argv[optind]);
+    if (field < 0) {
+	printf("readouts are CH1, CH2, Time, Trig and Freq\n");
+	return 1;
+    }
+    memset(&s, 0, sizeof(s));
+
+    /* a run is a value held from its first frame to its last */
+    for (i = optind + 1; i < argc; i++) {
+	if (readout_index_load(&ix, argv[i])) {
+	    printf("no readouts recorded for %s\n", argv[i]);
+	    continue;
+	}
+	for (k = 0; k < ix.count && !rv; k++) {
+	    if (ix.runs[k].field == (uint32_t) field) {
+		rv = trend_add(&s, ix.runs[k].first_timestamp,
+			       ix.runs[k].number)
+		    || trend_add(&s, ix.runs[k].last_timestamp,
+				 ix.runs[k].number);
+	    }
+	}
+	readout_index_free(&ix);
+    }
+    if (optind + 1 < argc) {
+	if (!rv) {
+	    draw_trend(&s, field, columns, seconds, 0);
+	}
+	trend_free(&s);
+	return rv;
+    }
+
+    if (load_font(font_path)) {
+	return 1;
+    }
+    if (!have_font) {
+	printf("no font to read readouts with, see -F\n");
+	return 1;
+    }
+    if (client_connect(&c, socket_path)) {
+	printf("error connecting to %s\n", socket_path);
+	return 1;
+    }
+    catch_signals();
+    draw_trend(&s, field, columns, seconds, 1);
+    while (!rv && next_live_frame(&c)) {
+	decode_unpack(c.payload, indexed);
+	readout_recognize(indexed, &font, text);
+	if (!readout_number(text[field], &number)) {
+	    rv = trend_add(&s, c.hdr.timestamp, number);
+	    draw_trend(&s, field, columns, seconds, 1);
+	}
+    }
+    client_close(&c);
+    trend_free(&s);
+    return rv;
+}
+
+/* read a frameid_log() file into times[id], returns the highest id or -1 */
+static long read_frame_log(const char * path, uint64_t ** times) {
+    unsigned long long ns;
+    unsigned int id;
+    long max = 0, size = 0, new_size;
+    uint64_t * t = NULL, * grown;
+    FILE * f;
+
+    f = fopen(path, "r");
+    if (!f) {
+	return -1;
+    }
+    while (fscanf(f, "%u %llu", &id, &ns) == 2) {
+	if (id >= LATENCY_MAX_FRAMES) {
+	    goto fail; /* not a frame number we could have sent */
+	}
+	if ((long) id >= size) {
+	    new_size = ((long) id + 1) * 2;
+	    if (new_size > LATENCY_MAX_FRAMES) {
+		new_size = LATENCY_MAX_FRAMES;
+	    }
+	    grown = realloc(t, new_size * sizeof(uint64_t));
+	    if (!grown) {
+		goto fail;
+	    }
+	    t = grown;
+	    memset(t + size, 0, (new_size - size) * sizeof(uint64_t));
+	    size = new_size;
+	}
+	if (!t[id]) {
+	    t[id] = ns; /* first time shown is what counts */
+	}
+	if ((long) id > max) {
+	    max = id;
+	}
+    }
+    fclose(f);
+    *times = t;
+    return t ? max : -1;
+
+fail:
+    fclose(f);
+    free(t);
+    return -1;
+}
+
+static int tool_latency(int argc, char *argv[]) {
+    uint64_t * requested, * presented;
+    long last_requested, last, id, first;
+    int i, count, drops;
+    double * ms;
+
+    if (argc < 3) {
+	return -1;
+    }
+    last_requested = read_frame_log(argv[1], &requested);
+    if (last_requested < 0) {
+	printf("error reading %s\n", argv[1]);
+	return 1;
+    }
+    for (i = 2; i < argc; i++) {
+	last = read_frame_log(argv[i], &presented);
+	if (last < 0) {
+	    printf("error reading %s\n", argv[i]);
+	    continue;
+	}
+	if (last > last_requested) {
+	    last = last_requested;
+	}
+	ms = calloc(last + 1, sizeof(double));
+	/* frames before the first shown were only the link starting up */
+	for (first = 1; first <= last && !presented[first]; first++) {
+	}
+	count = drops = 0;
+	for (id = first; id <= last && ms; id++) {
+	    if (!requested[id]) {
+		continue;
+	    }
+	    if (!presented[id]) {
+		drops++;
+	    } else {
+		ms[count++] = (presented[id] - requested[id]) / 1e6;
+	    }
+	}
+	printf("%s: %d frames shown, %d dropped\n", argv[i], count, drops);
+	stats_report(stdout, "request to photon", "ms", ms, count);
+	free(ms);
+	free(presented);
+    }
+    free(requested);
+    return 0;
+}
+
+static const struct {
+    const char * name;
+    int (*run)(int argc, char *argv[]);  /* returns -1 for bad usage */
+} tools[] = {
+    {"cmd", tool_cmd},
+    {"retheme", tool_retheme},
+    {"record", tool_record},
+    {"export", tool_export},
+    {"burst", tool_burst},
+    {"timelapse", tool_timelapse},
+    {"at", tool_at},
+    {"similar", tool_similar},
+    {"glyphs", tool_glyphs},
+    {"find", tool_find},
+    {"trend", tool_trend},
+    {"latency", tool_latency}};
+
+int main(int argc, char *argv[]) {
+    unsigned int i;
+    int rv;
+
+    for (i = 0; argc >= 2 && i < sizeof(tools) / sizeof(tools[0]); i++) {
+	if (!strcmp(argv[1], tools[i].name)) {
+	    rv = tools[i].run(argc - 1, argv + 1);
+	    if (rv >= 0) {
+		return rv;
+	    }
+	    break;
+	}
+    }
+    usage(argv[0]);
+    return 1;
+}
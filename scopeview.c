@@ -31,181 +31,368 @@
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib-unix.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <signal.h>
 #include <termios.h>
-#include <sys/time.h>
+#include <sys/ioctl.h>
+#include "scope.h"
+#include "shmring.h"
+#include "client.h"
+#include "pngwrite.h"
+#include "fft.h"
+#include "frameid.h"
+#include "overlay.h"
+#include "trace.h"
+#include "tty.h"
+#include "waveform.h"
+#include "zoom.h"
 
-#define INPUT_WIDTH 320  /* scope gives us 320 pixels per row */
 #define UPDATE_PERIOD 250  /* milliseconds between polling scope */
-#define RX_TIMEOUT 200000
-#define SCREEN_DUMP_SIZE 40960
-
-uint8_t acquire_scope_buffer(uint8_t * buffer);
+#define SPECTRUM_HEIGHT 120  /* pixels */
+#define SPECTRUM_POINTS 512  /* FFT size, WAVE_W samples zero padded */
+#define SPECTRUM_BINS (SPECTRUM_POINTS / 2 + 1)
+#define SPECTRUM_RANGE 80  /* dB from top to bottom of the pane */
+#define SPECTRUM_GRID 20  /* dB between grid lines */
 
+/* everything the viewer needs, handed to the GTK callbacks */
 typedef struct {
-    unsigned char r, g, b;
-} rgb_color;
-
-GdkPixbuf * pixbuf;
-guchar *pixels;
-int byte_cnt, console_fd;
-
-/* Original colors from LCD display */
-rgb_color colors_orig[] = {
-    {0x00, 0x00, 0x00},  /* Menu text                        */
-    {0x00, 0x00, 0x00},  /* Trace background                 */
-    {0xff, 0xff, 0x00},  /* Channel-1 trace/info             */
-    {0x80, 0x80, 0x80},  /* Unknown                          */
-    {0x00, 0xff, 0xff},  /* Channel-2 trace/info             */
-    {0x80, 0x80, 0x80},  /* Unknown                          */
-    {0x66, 0xff, 0x66},  /* Horiz./trigger info/markers      */
-    {0xff, 0xff, 0xff},  /* GUI text and borders             */
-    {0x88, 0x88, 0x88},  /* Trace reticle, menu shadow       */
-    {0x80, 0x80, 0x80},  /* Unknown                          */
-    {0x00, 0x00, 0x55},  /* GUI background                   */
-    {0xbb, 0xbb, 0xbb},  /* Menu background                  */
-    {0x80, 0x80, 0x80},  /* Unknown                          */
-    {0x80, 0x80, 0x80},  /* Unknown                          */
-    {0xff, 0x22, 0x22},  /* Math trace/info, logo background */
-    {0xff, 0xff, 0xff}}; /* Menu highlight                   */
-
-/* Happy colors with a white background */
-rgb_color colors_light[] = {
-    {0x55, 0x56, 0x50},  /* Menu text                        */
-    {0xf9, 0xf8, 0xf5},  /* Trace background                 */
-    {0xf9, 0x26, 0x72},  /* Channel-1 trace/info             */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x46, 0xa9, 0xdf},  /* Channel-2 trace/info             */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x86, 0xd2, 0x1e},  /* Horiz./trigger info/markers      */
-    {0x55, 0x56, 0x50},  /* GUI text and borders             */
-    {0xa5, 0xa1, 0xae},  /* Trace reticle, menu shadow       */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0xf8, 0xf8, 0xf2},  /* GUI background                   */
-    {0xf8, 0xf8, 0xf2},  /* Menu background                  */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0xf4, 0xbf, 0x35},  /* Math trace/info, logo background */
-    {0xf9, 0xf8, 0xf5}}; /* Menu highlight                   */
-
-/* Darker colors based on https://github.com/morhetz/gruvbox-generalized */
-rgb_color colors_dark[] = {
-    {0x1d, 0x1c, 0x1a},  /* Menu text                        */
-    {0x1d, 0x1c, 0x1a},  /* Trace background                 */
-    {0xd7, 0x99, 0x21},  /* Channel-1 trace/info             */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x45, 0x85, 0x88},  /* Channel-2 trace/info             */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0xb8, 0xbb, 0x26},  /* Horiz./trigger info/markers      */
-    {0xa8, 0x99, 0x84},  /* GUI text and borders             */
-    {0x92, 0x83, 0x74},  /* Trace reticle, menu shadow       */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x32, 0x30, 0x2f},  /* GUI background                   */
-    {0xa8, 0x99, 0x84},  /* Menu background                  */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0x80, 0x00, 0x80},  /* Unknown                          */
-    {0xfb, 0x49, 0x34},  /* Math trace/info, logo background */
-    {0xeb, 0xdb, 0xb2}}; /* Menu highlight                   */
-
-/* Black and white, for printing */
-rgb_color colors_mono[] = {
-    {0x00, 0x00, 0x00},  /* Menu text                        */
-    {0xff, 0xff, 0xff},  /* Trace background                 */
-    {0x00, 0x00, 0x00},  /* Channel-1 trace/info             */
-    {0xff, 0xff, 0xff},  /* Unknown                          */
-    {0x00, 0x00, 0x00},  /* Channel-2 trace/info             */
-    {0xff, 0xff, 0xff},  /* Unknown                          */
-    {0x00, 0x00, 0x00},  /* Horiz./trigger info/markers      */
-    {0x00, 0x00, 0x00},  /* GUI text and borders             */
-    {0x00, 0x00, 0x00},  /* Trace reticle, menu shadow       */
-    {0xff, 0xff, 0xff},  /* Unknown                          */
-    {0xff, 0xff, 0xff},  /* GUI background                   */
-    {0xff, 0xff, 0xff},  /* Menu background                  */
-    {0xff, 0xff, 0xff},  /* Unknown                          */
-    {0xff, 0xff, 0xff},  /* Unknown                          */
-    {0x00, 0x00, 0x00},  /* Math trace/info, logo background */
-    {0xff, 0xff, 0xff}}; /* Menu highlight                   */
-
-#define COLOR_THEME_COUNT 4
-static rgb_color *color_themes[] = {colors_dark, colors_light, colors_mono, colors_orig};
-static int theme = 0;
-static int row;
-static int col;
-static unsigned char in_byte;
-uint8_t buffer[SCREEN_DUMP_SIZE];
-fd_set set;
-struct timeval timeout;
-const uint8_t msg[] = { 0x57, 0x00, 0x00, 0x0A } ; /* screen capture request */
-int rv;
-int console_fd;
-gint win_w, win_h;
-
-GtkBuilder *builder;
-GtkWidget *window;
-GtkWidget *image_scope;
-GtkWidget *button_exit;
-GtkWidget *button_pause;
-GdkPixbuf * pixbuf_scope;
-GdkPixbuf * pixbuf_scaled;
-guchar * scope_pixels;
-
-static gboolean redraw_timer_handler(GtkWidget *widget) {
-    scope_pixels = gdk_pixbuf_get_pixels(pixbuf_scope);
-
-    if (acquire_scope_buffer(buffer)) { return TRUE; }
-
-    /* unpack input buffer data to output buffer */
-    for(byte_cnt=0; byte_cnt<SCREEN_DUMP_SIZE; byte_cnt++)
-	{
-	    /*
-	     * process output pixels 2 at a time, based on the current input byte.
-	     * each nibble of the input byte is used to index a color lookup table
-	     * and retrieve RGB values which are assigned to separatate output bytes.
-
-	     * because the input image is rotated -90 degrees from normal viewing
-	     * orientation, some division and modulus operators are used to save the
-	     * pixel data in the output buffer rotated by 90 degrees.
-	     */
-	    in_byte = buffer[byte_cnt];
-
-	    /* set up to save output data rotated by 90 degrees */
-	    row = byte_cnt%128;
-	    col = (INPUT_WIDTH-1)-byte_cnt/128;
-	    if(byte_cnt%128 < 120) // skip the last 8 rows of the image
-		{
-		    /* save pixel 1 of this input byte */
-		    scope_pixels[(320*3*(row*2))+(3*col)] =
-			color_themes[theme][((in_byte >> 4) & 0x0f)].r;
-		    scope_pixels[(320*3*(row*2))+(3*col)+1] =
-			color_themes[theme][((in_byte >> 4) & 0x0f)].g;
-		    scope_pixels[(320*3*(row*2))+(3*col)+2] =
-			color_themes[theme][((in_byte >> 4) & 0x0f)].b;
-		    /* save pixel 2 of this input byte */
-		    scope_pixels[(320*3*(row*2+1))+(3*col)] =
-			color_themes[theme][(in_byte & 0x0f)].r;
-		    scope_pixels[(320*3*(row*2+1))+(3*col)+1] =
-			color_themes[theme][(in_byte & 0x0f)].g;
-		    scope_pixels[(320*3*(row*2+1))+(3*col)+2] =
-			color_themes[theme][(in_byte & 0x0f)].b;
+    int theme;
+    palette_lut luts[PALETTE_MAX];  /* every theme, so switching is free */
+
+    /* frames come from the serial port, or from scopeviewd if connected */
+    scope_device scope;
+    const char * daemon_socket;
+    scope_client daemon;
+    uint8_t daemon_frame[FRAME_PIXELS];
+    const uint8_t * frame;  /* latest frame as color indices */
+    uint64_t seq;  /* and its sequence number */
+    int have_frame;
+    int stale;  /* the scope or daemon went away, frame is the last one seen */
+
+    /* a pinned frame shown under the live one */
+    int have_reference;
+    int overlay_mode;
+    uint8_t reference[FRAME_PIXELS];
+    uint8_t composite[FRAME_PIXELS];  /* reference << 4 | frame */
+    overlay_palette overlay;  /* for the current theme and mode */
+
+    /* amplitude spectra of the channel traces, in a pane under the picture */
+    int show_spectrum;
+    fft_plan fft;
+    float spectrum[WAVE_CHANNELS][SPECTRUM_BINS];  /* dB */
+    int have_spectrum[WAVE_CHANNELS];  /* the channel is on */
+
+    /* optional shared-memory ring for other local consumers */
+    const char * ring_name;
+    frame_ring * ring;
+
+    /* with --latency, when each stamped frame went on screen */
+    FILE * latency_log;
+
+    /* with --tty, drawn in the terminal instead of a window */
+    int tty;
+    tty_view term;
+    GMainLoop * loop;
+    struct termios saved_termios;
+    int raw_mode;  /* saved_termios holds what to restore */
+
+    GtkBuilder * builder;
+    GtkWidget * window;
+    GtkWidget * image_scope;
+    GdkPixbuf * pixbuf_view;  /* window sized */
+    gint win_w, win_h;  /* of the picture, the window less any spectrum */
+    GtkWidget * image_spectrum;
+    GdkPixbuf * pixbuf_spectrum;
+
+    /* the part of the frame on screen, zoom_level times magnified */
+    zoom_view zoom;
+    int zoom_level;
+    int view_x, view_y;
+    int dragging;
+    gdouble drag_x, drag_y;  /* where the pointer went down */
+    int drag_view_x, drag_view_y;  /* and view_x, view_y then */
+} viewer;
+
+/* the terminal's version of draw_frame(), whole frame, changed cells only */
+static void draw_terminal(viewer * v) {
+    const uint8_t (*colors)[3] = v->luts[v->theme].rgb;
+    const uint8_t * frame = v->frame;
+    uint8_t dim[256][3];
+    size_t length;
+    int i;
+
+    TRACE(scale_start, v->seq);
+    if (v->have_reference) {
+	overlay_compose(v->frame, v->reference, v->composite, FRAME_PIXELS);
+	frame = v->composite;
+	colors = v->overlay.rgb;
+    }
+    if (v->stale) {
+	for (i = 0; i < (v->have_reference ? 256 : 16); i++) {
+	    dim[i][0] = colors[i][0] / 3;
+	    dim[i][1] = colors[i][1] / 3;
+	    dim[i][2] = colors[i][2] / 3;
+	}
+	colors = dim;
+	tty_invalidate(&v->term);
+    }
+    length = tty_render(&v->term, frame, colors);
+    if (v->stale) {
+	tty_invalidate(&v->term);
+    }
+    TRACE(scale_end, v->seq);
+    fwrite(v->term.out, 1, length, stdout);
+    fflush(stdout);
+    TRACE(present, v->seq);
+}
+
+/* draw the frame as it is, in the current theme, zoom and position */
+static void draw_frame(viewer * v) {
+    guchar * pixels;
+    int stride, i;
+
+    if (v->tty && v->have_frame) {
+	draw_terminal(v);
+	return;
+    }
+    if (!v->have_frame || !v->pixbuf_view) {
+	return;
+    }
+    pixels = gdk_pixbuf_get_pixels(v->pixbuf_view);
+    stride = gdk_pixbuf_get_rowstride(v->pixbuf_view);
+    TRACE(scale_start, v->seq);
+    if (v->stale) {
+	zoom_invalidate(&v->zoom);
+    }
+    if (v->have_reference) {
+	overlay_compose(v->frame, v->reference, v->composite, FRAME_PIXELS);
+	zoom_render(&v->zoom, v->composite, v->overlay.rgb, pixels, stride);
+    } else {
+	zoom_render(&v->zoom, v->frame, v->luts[v->theme].rgb, pixels,
+		    stride);
+    }
+    if (v->stale) {
+	/* dimmed, so nobody takes it for live */
+	for (i = 0; i < stride * v->win_h; i++) {
+	    pixels[i] /= 3;
+	}
+	zoom_invalidate(&v->zoom);
+    }
+    TRACE(scale_end, v->seq);
+    gtk_image_set_from_pixbuf(GTK_IMAGE(v->image_scope), v->pixbuf_view);
+    TRACE(present, v->seq);
+    gtk_widget_queue_draw(v->window);
+}
+
+/* a line per channel, louder is higher, frequency left to right */
+static void draw_spectrum(viewer * v) {
+    const palette_lut * lut = &v->luts[v->theme];
+    guchar * pixels, * p;
+    float peak;
+    int stride, x, y, c, b, b1, level, last;
+
+    if (!v->show_spectrum || v->win_w <= 0) {
+	return;
+    }
+    if (!v->pixbuf_spectrum
+	|| gdk_pixbuf_get_width(v->pixbuf_spectrum) != v->win_w) {
+	if (v->pixbuf_spectrum) {
+	    g_object_unref(v->pixbuf_spectrum);
+	}
+	v->pixbuf_spectrum = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
+					    v->win_w, SPECTRUM_HEIGHT);
+    }
+    pixels = gdk_pixbuf_get_pixels(v->pixbuf_spectrum);
+    stride = gdk_pixbuf_get_rowstride(v->pixbuf_spectrum);
+
+    /* trace background, with the graticule color every SPECTRUM_GRID dB */
+    for (y = 0; y < SPECTRUM_HEIGHT; y++) {
+	level = y * SPECTRUM_RANGE / (SPECTRUM_HEIGHT - 1);
+	c = level / SPECTRUM_GRID
+	    != (y + 1) * SPECTRUM_RANGE / (SPECTRUM_HEIGHT - 1) / SPECTRUM_GRID
+	    ? 8 : 1;
+	for (x = 0; x < v->win_w; x++) {
+	    memcpy(pixels + y * stride + 3 * x, lut->rgb[c], 3);
+	}
+    }
+
+    for (c = 0; c < WAVE_CHANNELS; c++) {
+	if (!v->have_spectrum[c]) {
+	    continue;
+	}
+	last = -1;
+	for (x = 0; x < v->win_w; x++) {
+	    /* the loudest of the bins under this column, DC left out */
+	    b = 1 + x * (SPECTRUM_BINS - 1) / v->win_w;
+	    b1 = 1 + (x + 1) * (SPECTRUM_BINS - 1) / v->win_w;
+	    for (peak = v->spectrum[c][b]; b < b1; b++) {
+		peak = v->spectrum[c][b] > peak ? v->spectrum[c][b] : peak;
+	    }
+	    y = -peak * (SPECTRUM_HEIGHT - 1) / SPECTRUM_RANGE;
+	    y = y < 0 ? 0 : y >= SPECTRUM_HEIGHT ? SPECTRUM_HEIGHT - 1 : y;
+	    /* join up with the last column */
+	    for (level = last < 0 ? y : last; ; level += level < y ? 1 : -1) {
+		p = pixels + level * stride + 3 * x;
+		memcpy(p, lut->rgb[wave_colors[c]], 3);
+		if (level == y) {
+		    break;
 		}
+	    }
+	    last = y;
+	}
+    }
+    gtk_image_set_from_pixbuf(GTK_IMAGE(v->image_spectrum),
+			      v->pixbuf_spectrum);
+}
+
+/* read the traces off the frame and transform them */
+static void update_spectrum(viewer * v) {
+    float samples[WAVE_W];
+    int c;
+
+    for (c = 0; c < WAVE_CHANNELS; c++) {
+	v->have_spectrum[c] = waveform_extract(v->frame, wave_colors[c],
+					       samples) > 0;
+	if (v->have_spectrum[c]) {
+	    fft_spectrum(&v->fft, samples, WAVE_W, WAVE_H / 2.0f,
+			 v->spectrum[c]);
 	}
+    }
+    draw_spectrum(v);
+}
+
+/* put the latest frame on screen and tell whoever else wants it */
+static void show_frame(viewer * v) {
+    uint32_t id;
+
+    v->have_frame = 1;
+    if (v->ring && !v->stale) {
+	ring_publish(v->ring, v->frame, v->theme);
+    }
+    draw_frame(v);
+    if (v->show_spectrum && !v->stale) {
+	update_spectrum(v);
+    }
+    if (!v->stale && v->latency_log && !frameid_read(v->frame, &id)) {
+	frameid_log(v->latency_log, id);
+    }
+}
+
+/* fit the view to the window, zoom level and position, and redraw */
+static void set_view(viewer * v, int level, int x, int y) {
+    int w = FRAME_WIDTH / level, h = FRAME_HEIGHT / level;
 
-    pixbuf_scaled = gdk_pixbuf_scale_simple (pixbuf_scope, win_w, win_h,
-					     GDK_INTERP_NEAREST);
-    gtk_image_set_from_pixbuf(GTK_IMAGE(image_scope), pixbuf_scaled);
-    g_object_unref(pixbuf_scaled);
-    gtk_widget_queue_draw(window);
+    if (v->win_w <= 0 || v->win_h <= 0) {
+	return;
+    }
+    v->zoom_level = level;
+    v->view_x = x < 0 ? 0 : x > FRAME_WIDTH - w ? FRAME_WIDTH - w : x;
+    v->view_y = y < 0 ? 0 : y > FRAME_HEIGHT - h ? FRAME_HEIGHT - h : y;
+    if (!v->pixbuf_view || gdk_pixbuf_get_width(v->pixbuf_view) != v->win_w
+	|| gdk_pixbuf_get_height(v->pixbuf_view) != v->win_h) {
+	if (v->pixbuf_view) {
+	    g_object_unref(v->pixbuf_view);
+	}
+	v->pixbuf_view = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
+					v->win_w, v->win_h);
+    }
+    zoom_set(&v->zoom, v->view_x, v->view_y, w, h, v->win_w, v->win_h);
+    draw_frame(v);
+}
+
+/* keep the last frame up, dimmed, and say why in the title bar */
+static void set_stale(viewer * v, int stale) {
+    if (v->stale == stale) {
+	return;
+    }
+    v->stale = stale;
+    if (v->tty) {
+	/* on the line under the picture */
+	printf("\033[%d;1H\033[K%s", v->term.rows + 1,
+	       stale ? "no signal" : "");
+	fflush(stdout);
+    } else {
+	gtk_window_set_title(GTK_WINDOW(v->window),
+			     stale ? "scopeview (no signal)" : "scopeview");
+    }
+    if (stale) {
+	draw_frame(v);
+    }
+}
+
+/*
+ * while the scope is away scope_capture() fails at once, so the UI thread
+ * only blocks on the occasional attempt to reopen the port.
+ */
+static gboolean redraw_timer_handler(gpointer data) {
+    viewer * v = data;
+
+    if (!scope_capture(&v->scope)) {
+	v->seq = v->scope.seq;
+	set_stale(v, 0);
+	show_frame(v);
+    } else if (!v->scope.connected) {
+	set_stale(v, 1);
+    }
+    return TRUE;
+}
+
+/* a device node appeared, if it is the scope's try it now */
+static gboolean hotplug_handler(GIOChannel *source, GIOCondition cond,
+				gpointer data) {
+    viewer * v = data;
+
+    if (scope_watch_event(&v->scope) && !v->scope.connected) {
+	scope_retry(&v->scope);
+	redraw_timer_handler(v);
+    }
+    return TRUE;
+}
+
+/* frames from the daemon are already rotated, just apply the color theme */
+static gboolean daemon_frame_handler(GIOChannel *source, GIOCondition cond,
+				     gpointer data) {
+    viewer * v = data;
+    int rv;
+
+    while ((rv = client_recv(&v->daemon)) == 1) {
+	if (v->daemon.hdr.type != MSG_FRAME) {
+	    continue;
+	}
+	v->seq = v->daemon.hdr.seq;
+	TRACE(decode_start, v->seq);
+	decode_unpack(v->daemon.payload, v->daemon_frame);
+	TRACE(decode_end, v->seq);
+	show_frame(v);
+    }
+    if (rv < 0) {
+	printf("lost connection to %s\n", v->daemon_socket);
+	set_stale(v, 1);
+	return FALSE; /* keep the last frame on screen */
+    }
     return TRUE;
 }
 
-gboolean on_configure(GtkWidget *widget, GdkEventConfigure *event, gpointer user_data ) {
-    win_w = event->width;
-    win_h = event->height;
-    gtk_widget_queue_draw(window);
+gboolean on_configure(GtkWidget *widget, GdkEventConfigure *event,
+		      gpointer data) {
+    viewer * v = data;
+
+    int height = event->height - (v->show_spectrum ? SPECTRUM_HEIGHT : 0);
+
+    if (event->width != v->win_w || height != v->win_h) {
+	v->win_w = event->width;
+	v->win_h = height;
+	set_view(v, v->zoom_level, v->view_x, v->view_y);
+	draw_spectrum(v);
+    }
     return FALSE;
 }
 
@@ -213,117 +400,432 @@ void on_window_destroy () {
     gtk_main_quit();
 }
 
-gboolean key_event(GtkWidget *widget, GdkEventKey *event) {
-    if (event->keyval == GDK_KEY_space) {
-	theme = (theme + 1) % COLOR_THEME_COUNT;
+struct snapshot_job {
+    char path[64];
+    rgb_color palette[16];
+    uint8_t packed[FRAME_PACKED_SIZE];
+};
+
+/* runs off the UI thread, so a slow disk never stalls the view */
+static gpointer snapshot_thread(gpointer data) {
+    struct snapshot_job * job = data;
+    uint8_t * png;
+    size_t length;
+    FILE * f;
+
+    if (png_encode_packed(job->packed, FRAME_WIDTH, FRAME_HEIGHT, job->palette,
+			  &png, &length)) {
+	printf("error encoding snapshot\n");
+    } else {
+	f = fopen(job->path, "wb");
+	if (!f || fwrite(png, 1, length, f) != length) {
+	    printf("error writing %s\n", job->path);
+	} else {
+	    printf("saved %s\n", job->path);
+	}
+	if (f) {
+	    fclose(f);
+	}
+	free(png);
     }
-    return FALSE;
+    g_free(job);
+    return NULL;
 }
 
-uint8_t gui_init(int argc, char *argv[]) {
-    gtk_init(&argc, &argv);
-    builder = gtk_builder_new();
-    gtk_builder_add_from_file(builder, "scopeview.glade", NULL);
-    window = GTK_WIDGET(gtk_builder_get_object(builder, "window"));
-    image_scope = GTK_WIDGET(gtk_builder_get_object(builder, "image_scope"));
-    gtk_builder_connect_signals(builder, NULL);
-    pixbuf_scope = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, 320, 240);
+/* save the current frame as a 4 bit indexed PNG in the working directory */
+static void snapshot(viewer * v) {
+    struct snapshot_job * job;
+    struct tm tm;
+    time_t now;
 
-    /* enable timers */
-    g_timeout_add(UPDATE_PERIOD, (GSourceFunc) redraw_timer_handler,
-		  (gpointer) window);
+    if (!v->have_frame) {
+	return;
+    }
+    job = g_malloc(sizeof(*job));
+    now = time(NULL);
+    localtime_r(&now, &tm);
+    strftime(job->path, sizeof(job->path), "scopeview-%Y%m%d-%H%M%S.png", &tm);
+    memcpy(job->palette, color_themes[v->theme], sizeof(job->palette));
+    decode_pack(v->frame, job->packed);
+    g_thread_unref(g_thread_new("snapshot", snapshot_thread, job));
+}
 
-    /* set up drawing callback */
-    g_signal_connect(G_OBJECT(window), "configure-event",
-		     G_CALLBACK(on_configure), 0 );
+/* after a change of theme or reference, redraw without waiting for a frame */
+static void recolor(viewer * v) {
+    if (v->have_reference) {
+	overlay_palette_init(&v->overlay, color_themes[v->theme],
+			     v->overlay_mode);
+    }
+    zoom_invalidate(&v->zoom);
+    tty_invalidate(&v->term);
+    draw_frame(v);
+    draw_spectrum(v);
+}
 
-    g_signal_connect(window, "key-press-event", G_CALLBACK(key_event), NULL);
-    return 0;
+/* the same keys work in the window and, being ASCII, in the terminal */
+static void key_press(viewer * v, guint key) {
+    if (key == GDK_KEY_space) {
+	v->theme = (v->theme + 1) % theme_count;
+	recolor(v);
+    } else if (key == GDK_KEY_r && v->have_frame) {
+	memcpy(v->reference, v->frame, FRAME_PIXELS);
+	v->have_reference = 1;
+	recolor(v);
+    } else if (key == GDK_KEY_R) {
+	v->have_reference = 0;
+	recolor(v);
+    } else if (key == GDK_KEY_o) {
+	v->overlay_mode = (v->overlay_mode + 1) % OVERLAY_MODES;
+	recolor(v);
+    } else if (key == GDK_KEY_s) {
+	snapshot(v);
+    } else if (key == GDK_KEY_f && !v->tty) {
+	v->show_spectrum = !v->show_spectrum;
+	if (v->show_spectrum) {
+	    if (v->have_frame) {
+		update_spectrum(v);
+	    }
+	    gtk_widget_show(v->image_spectrum);
+	} else {
+	    gtk_widget_hide(v->image_spectrum);
+	}
+    } else if (key == GDK_KEY_0) {
+	set_view(v, 1, 0, 0);
+    }
 }
 
-int serial_init(const char * dev) {
-    struct termios tio;
-    int console_fd;
+gboolean key_event(GtkWidget *widget, GdkEventKey *event, gpointer data) {
+    key_press(data, event->keyval);
+    return FALSE;
+}
 
-    memset(&tio, 0, sizeof(tio));
-    tio.c_iflag = 0;
-    tio.c_oflag = 0;
-    tio.c_cflag = CS8 | CREAD | CLOCAL; /* 8N1, see termios.h for more info */
-    tio.c_lflag = 0;
+/* the wheel zooms in and out, keeping the pixel under the pointer put */
+gboolean scroll_event(GtkWidget *widget, GdkEventScroll *event,
+		      gpointer data) {
+    viewer * v = data;
+    int level = v->zoom_level, fx, fy;
+
+    if (event->direction == GDK_SCROLL_UP
+	|| (event->direction == GDK_SCROLL_SMOOTH && event->delta_y < 0)) {
+	level = level < ZOOM_MAX ? level * 2 : level;
+    } else if (event->direction == GDK_SCROLL_DOWN
+	       || (event->direction == GDK_SCROLL_SMOOTH
+		   && event->delta_y > 0)) {
+	level = level > 1 ? level / 2 : level;
+    }
+    if (level == v->zoom_level || v->win_w <= 0 || v->win_h <= 0) {
+	return TRUE;
+    }
+    fx = v->view_x + event->x * FRAME_WIDTH / v->zoom_level / v->win_w;
+    fy = v->view_y + event->y * FRAME_HEIGHT / v->zoom_level / v->win_h;
+    set_view(v, level, fx - event->x * FRAME_WIDTH / level / v->win_w,
+	     fy - event->y * FRAME_HEIGHT / level / v->win_h);
+    return TRUE;
+}
 
-    console_fd = open(dev, O_RDWR);
-    if (console_fd == -1) {
-	return 0; /* error */
+/* dragging with the first button moves the view around */
+gboolean button_event(GtkWidget *widget, GdkEventButton *event,
+		      gpointer data) {
+    viewer * v = data;
+
+    if (event->button == 1) {
+	v->dragging = event->type == GDK_BUTTON_PRESS;
+	v->drag_x = event->x;
+	v->drag_y = event->y;
+	v->drag_view_x = v->view_x;
+	v->drag_view_y = v->view_y;
     }
+    return TRUE;
+}
 
-    cfsetospeed(&tio, B1200);
-    cfsetispeed(&tio, B1200);
+gboolean motion_event(GtkWidget *widget, GdkEventMotion *event,
+		      gpointer data) {
+    viewer * v = data;
+    int x, y;
 
-    tcsetattr(console_fd, TCSANOW, &tio);
+    if (!v->dragging || v->zoom_level == 1) {
+	return TRUE;
+    }
+    x = v->drag_view_x - (event->x - v->drag_x) * FRAME_WIDTH
+	/ v->zoom_level / v->win_w;
+    y = v->drag_view_y - (event->y - v->drag_y) * FRAME_HEIGHT
+	/ v->zoom_level / v->win_h;
+    if (x != v->view_x || y != v->view_y) {
+	set_view(v, v->zoom_level, x, y);
+    }
+    return TRUE;
+}
 
-    return console_fd;
+/* have the main loop pick up frames from the daemon or poll the scope */
+static void watch_frames(viewer * v) {
+    if (v->daemon_socket) {
+	/* frames arrive whenever the daemon has them */
+	g_io_add_watch(g_io_channel_unix_new(v->daemon.fd),
+		       G_IO_IN | G_IO_HUP | G_IO_ERR, daemon_frame_handler, v);
+    } else {
+	/* enable timers */
+	g_timeout_add(UPDATE_PERIOD, redraw_timer_handler, v);
+	if (scope_watch(&v->scope) != -1) {
+	    g_io_add_watch(g_io_channel_unix_new(v->scope.watch), G_IO_IN,
+			   hotplug_handler, v);
+	}
+    }
 }
 
-uint8_t acquire_scope_buffer(uint8_t * buffer) {
-    uint8_t * buffer_index = &buffer[0];
-    uint8_t temp_buffer[64];
-    int rval;
-    int total = 0;
-
-    /* request data */
-    timeout.tv_sec = 0;
-    timeout.tv_usec = RX_TIMEOUT;
-    FD_SET(console_fd, &set);
-    write(console_fd, &msg, 4);
-
-    while (1) {
-	rv = select(console_fd + 1, &set, NULL, NULL, &timeout);
-	if (rv == -1) {
-	    /* error? */
-	    return 1;
-	} else if (rv == 0) {
-	    /* timeout */
-	    return 1;
+uint8_t gui_init(viewer * v, int argc, char *argv[]) {
+    gtk_init(&argc, &argv);
+    v->builder = gtk_builder_new();
+    gtk_builder_add_from_file(v->builder, "scopeview.glade", NULL);
+    v->window = GTK_WIDGET(gtk_builder_get_object(v->builder, "window"));
+    v->image_scope = GTK_WIDGET(gtk_builder_get_object(v->builder,
+							"image_scope"));
+    v->image_spectrum = GTK_WIDGET(gtk_builder_get_object(v->builder,
+							   "image_spectrum"));
+    gtk_builder_connect_signals(v->builder, NULL);
+    v->zoom_level = 1;
+    watch_frames(v);
+
+    /* set up drawing callback */
+    g_signal_connect(G_OBJECT(v->window), "configure-event",
+		     G_CALLBACK(on_configure), v);
+
+    g_signal_connect(v->window, "key-press-event", G_CALLBACK(key_event), v);
+    gtk_widget_add_events(v->window, GDK_SCROLL_MASK | GDK_BUTTON_PRESS_MASK
+			  | GDK_BUTTON_RELEASE_MASK | GDK_BUTTON1_MOTION_MASK);
+    g_signal_connect(v->window, "scroll-event", G_CALLBACK(scroll_event), v);
+    g_signal_connect(v->window, "button-press-event",
+		     G_CALLBACK(button_event), v);
+    g_signal_connect(v->window, "button-release-event",
+		     G_CALLBACK(button_event), v);
+    g_signal_connect(v->window, "motion-notify-event",
+		     G_CALLBACK(motion_event), v);
+    return 0;
+}
+
+/* fit the picture to the terminal and draw it all again */
+static gboolean terminal_resized(gpointer data) {
+    viewer * v = data;
+    struct winsize ws;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) || ws.ws_row < 2
+	|| tty_set(&v->term, ws.ws_col, ws.ws_row - 1)) {
+	/* too small, or not a terminal: assume the classic 80x24 */
+	tty_set(&v->term, 80, 23);
+    }
+    printf("\033[2J\033[%d;1H%s", v->term.rows + 1,
+	   v->stale ? "no signal" : "");
+    draw_frame(v);
+    return TRUE;
+}
+
+static gboolean terminal_key(GIOChannel *source, GIOCondition cond,
+			     gpointer data) {
+    viewer * v = data;
+    char keys[64];
+    ssize_t i, n;
+
+    n = read(STDIN_FILENO, keys, sizeof(keys));
+    for (i = 0; i < n; i++) {
+	if (keys[i] == 'q') {
+	    g_main_loop_quit(v->loop);
 	} else {
-	    rval = read(console_fd, &temp_buffer, 64);
-	    if (rval > 0) {
-		total += rval;
-		if (total <= SCREEN_DUMP_SIZE) {
-		    memcpy(buffer_index, &temp_buffer, rval);
-		    buffer_index += rval;
-		} else {
-		    printf(">> overflow: last rval=%d, bytes total=%d\n", rval, total);
-		    return 1;
-		}
-		if (total == SCREEN_DUMP_SIZE) {
-		    /* just the exact amount of data we wanted */
-		    return 0;
-		}
-	    }
+	    key_press(v, (unsigned char) keys[i]);
 	}
     }
+    if (n <= 0) {
+	g_main_loop_quit(v->loop);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean terminal_quit(gpointer data) {
+    viewer * v = data;
+
+    g_main_loop_quit(v->loop);
+    return TRUE;
+}
+
+/* keys without waiting for enter or echoing them, the cursor hidden */
+static void tty_init(viewer * v) {
+    struct termios raw;
+
+    if (tcgetattr(STDIN_FILENO, &v->saved_termios) == 0) {
+	raw = v->saved_termios;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	v->raw_mode = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+	g_io_add_watch(g_io_channel_unix_new(STDIN_FILENO),
+		       G_IO_IN | G_IO_HUP | G_IO_ERR, terminal_key, v);
+    }
+    v->loop = g_main_loop_new(NULL, FALSE);
+    g_unix_signal_add(SIGINT, terminal_quit, v);
+    g_unix_signal_add(SIGTERM, terminal_quit, v);
+    g_unix_signal_add(SIGWINCH, terminal_resized, v);
+    printf("\033[?25l");
+    terminal_resized(v);
+    watch_frames(v);
+}
+
+/* put the terminal back the way it was */
+static void tty_close(viewer * v) {
+    printf("\033[0m\033[?25h\033[%d;1H\033[K", v->term.rows + 1);
+    fflush(stdout);
+    if (v->raw_mode) {
+	tcsetattr(STDIN_FILENO, TCSANOW, &v->saved_termios);
+    }
+    g_main_loop_unref(v->loop);
+    tty_free(&v->term);
+}
+
+void usage(const char * name) {
+    printf("usage: %s [options] <serial-device>\n", name);
+    printf("       %s [options] --connect[=PATH]\n", name);
+    printf("  -c, --connect[=PATH]  view frames served by scopeviewd on PATH"
+	   " (default %s)\n", PROTO_DEFAULT_SOCKET);
+    printf("  -s, --shm[=NAME]      publish frames to shared memory ring NAME"
+	   " (default %s)\n", RING_DEFAULT_NAME);
+    printf("  -t, --theme=NAME      start in this theme, or load a palette"
+	   " file (repeatable)\n");
+    printf("  -L, --latency=FILE    log when frames from scopeemu are shown\n");
+    printf("  -m, --model=NAME|auto scope model (default GDS-820C), auto asks"
+	   " the scope\n");
+    printf("  -T, --tty             draw in the terminal, for ssh sessions"
+	   " (q quits)\n");
 }
 
 int main(int argc, char *argv[]) {
-    /* initialize serial port */
-    console_fd = serial_init(argv[1]);
-    if (!console_fd) {
-	printf ("error opening serial port\n");
+    static const struct option options[] = {
+	{"shm", optional_argument, NULL, 's'},
+	{"connect", optional_argument, NULL, 'c'},
+	{"theme", required_argument, NULL, 't'},
+	{"latency", required_argument, NULL, 'L'},
+	{"model", required_argument, NULL, 'm'},
+	{"tty", no_argument, NULL, 'T'},
+	{"help", no_argument, NULL, 'h'},
+	{NULL, 0, NULL, 0}};
+    const scope_model * model = &scope_models[MODEL_DEFAULT];
+    const char * model_name = NULL;
+    static viewer v;
+    int opt, i;
+
+    while ((opt = getopt_long(argc, argv, "sct:L:m:Th", options, NULL)) != -1) {
+	switch (opt) {
+	case 's':
+	    v.ring_name = optarg ? optarg : RING_DEFAULT_NAME;
+	    break;
+	case 'c':
+	    v.daemon_socket = optarg ? optarg : PROTO_DEFAULT_SOCKET;
+	    break;
+	case 'L':
+	    v.latency_log = fopen(optarg, "w");
+	    if (!v.latency_log) {
+		printf ("error creating %s\n", optarg);
+		return 1;
+	    }
+	    break;
+	case 'm':
+	    model_name = optarg;
+	    break;
+	case 'T':
+	    v.tty = 1;
+	    break;
+	case 't':
+	    v.theme = palette_select(optarg);
+	    if (v.theme < 0) {
+		return 1;
+	    }
+	    break;
+	default:
+	    usage(argv[0]);
+	    return 1;
+	}
+    }
+    if (model_name && strcmp(model_name, "auto")
+	&& !(model = model_find(model_name))) {
+	printf("unknown model %s\n", model_name);
+	return 1;
+    }
+    if (!v.daemon_socket && optind >= argc) {
+	usage(argv[0]);
 	return 1;
     }
 
-    /* initialize user interface */
-    if (gui_init(argc, argv)) {
-	printf ("error setting up gui\n");
+    for (i = 0; i < theme_count; i++) {
+	palette_lut_init(&v.luts[i], color_themes[i]);
+    }
+    if (fft_init(&v.fft, SPECTRUM_POINTS)) {
+	printf ("error setting up the FFT\n");
 	return 1;
     }
 
-    /* show main window and enter main loop */
-    gtk_widget_show(window);
-    gtk_main();
+    if (v.daemon_socket) {
+	/* let scopeviewd own the serial port */
+	if (client_connect(&v.daemon, v.daemon_socket)) {
+	    printf ("error connecting to %s\n", v.daemon_socket);
+	    return 1;
+	}
+	fcntl(v.daemon.fd, F_SETFL, fcntl(v.daemon.fd, F_GETFL) | O_NONBLOCK);
+	v.frame = v.daemon_frame;
+    } else {
+	/* initialize serial port */
+	if (scope_open_model(&v.scope, argv[optind], model)) {
+	    printf ("error opening serial port\n");
+	    return 1;
+	}
+	if (model_name && !strcmp(model_name, "auto")
+	    && scope_identify(&v.scope)) {
+	    printf ("scope didn't say which model it is, assuming %s\n",
+		    v.scope.model->name);
+	}
+	v.frame = v.scope.indexed;
+    }
+
+    /* initialize shared-memory frame ring */
+    if (v.ring_name) {
+	v.ring = ring_create(v.ring_name, RING_DEFAULT_SLOTS);
+	if (!v.ring) {
+	    printf ("error creating shared memory ring %s\n", v.ring_name);
+	    return 1;
+	}
+    }
+
+    if (v.tty) {
+	/* no window, frames go to the terminal */
+	tty_init(&v);
+	g_main_loop_run(v.loop);
+	tty_close(&v);
+    } else {
+	/* initialize user interface */
+	if (gui_init(&v, argc, argv)) {
+	    printf ("error setting up gui\n");
+	    return 1;
+	}
+
+	/* show main window and enter main loop */
+	gtk_widget_show(v.window);
+	gtk_main();
+	g_object_unref(G_OBJECT(v.builder));
+    }
 
     /* clean up and exit */
-    g_object_unref(G_OBJECT(builder));
-    close(console_fd);
+    if (v.pixbuf_view) {
+	g_object_unref(v.pixbuf_view);
+    }
+    if (v.pixbuf_spectrum) {
+	g_object_unref(v.pixbuf_spectrum);
+    }
+    zoom_free(&v.zoom);
+    fft_free(&v.fft);
+    ring_close(v.ring, v.ring_name);
+    if (v.latency_log) {
+	fclose(v.latency_log);
+    }
+    if (v.daemon_socket) {
+	client_close(&v.daemon);
+    } else {
+	scope_close(&v.scope);
+    }
     return 0;
 }
@@ -0,0 +1,928 @@
+/*
+ * About : Daemon that owns the scope's serial port and serves frames to
+ *         any number of local clients.
+ *
+ * Notes :
+ *
+ * An acquisition thread polls the scope every period, exactly like the
+ * viewer's timer used to, and hands each new frame to the main thread. The
+ * main thread encodes it once into a reference counted message (header plus
+ * packed pixels, see proto.h) and queues that same buffer on every client
+ * socket.
+ *
+ * Each client holds at most the message it is currently sending and the
+ * newest one waiting behind it. When a newer frame arrives for a client that
+ * is still busy, the waiting one is dropped, so a slow client gets fewer
+ * frames instead of stalling the daemon or everyone else.
+ *
+ * Clients can also send scope commands (see proto.h). They wait in a queue
+ * ordered by priority and deadline, and the acquisition thread runs them
+ * between screen dumps, so automation and screen updates share the port
+ * without either starving the other.
+ *
+ * With --http, the live view is also served to web browsers, see httpd.c.
+ *
+ * If the scope goes away, the last frame is all clients have until it is
+ * back. The port is reopened with growing delays in between, or as soon as
+ * its device node reappears (see scope.h).
+ *
+ * With --realtime, memory is locked and the acquisition thread is pinned to
+ * one CPU at SCHED_FIFO priority (see rt.h), as far as the system allows.
+ * How late each dump started and how long it took are printed on exit.
+ *
+ * Usage : scopeviewd [-p MS] [-l PATH] [--shm[=NAME]] [--http=PORT|PATH]
+ *                    [--theme=NAME] [--realtime[=CPU]] [--model=NAME|auto]
+ *                    <serial-device>
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "decode.h"
+#include "httpd.h"
+#include "palette.h"
+#include "proto.h"
+#include "rt.h"
+#include "scope.h"
+#include "shmring.h"
+#include "stats.h"
+
+#define UPDATE_PERIOD 250  /* default milliseconds between polling scope */
+#define MAX_CLIENTS 64
+#define CMD_QUEUE_MAX 64
+#define CMD_BURST 4  /* normal priority commands allowed to delay a dump */
+#define CMD_LOW_WAIT 8  /* dumps a low priority command waits out at most */
+#define JITTER_SAMPLES 65536  /* dumps kept for the --realtime report */
+
+/* an encoded message, shared by every client it is queued on */
+struct msg_buf {
+    struct msg_buf * link;  /* reply queues */
+    uint64_t client_id;  /* replies: client that sent the command */
+    int refs;
+    size_t size;
+    uint8_t data[];
+};
+
+struct client {
+    int fd;
+    uint64_t id;
+    struct msg_buf * cur;  /* message being sent */
+    size_t off;  /* bytes of cur already sent */
+    struct msg_buf * next;  /* newest frame waiting behind cur */
+    struct msg_buf * replies;  /* replies waiting, these go before frames */
+    uint64_t skipped;
+    size_t rx_have;  /* bytes of the command being received */
+    struct proto_header rx_hdr;
+    uint8_t rx_data[CMD_MAX];
+};
+
+struct command {
+    struct command * link;
+    uint64_t client_id;
+    uint64_t id;
+    int flags;
+    struct timespec deadline;  /* tv_sec 0 if none */
+    uint64_t order;  /* arrival, breaks ties */
+    size_t length;
+    uint8_t data[CMD_MAX];
+};
+
+static volatile sig_atomic_t quit;
+static scope_device scope;  /* port and frames: acquisition thread only */
+static int period = UPDATE_PERIOD;
+static const char * socket_path = PROTO_DEFAULT_SOCKET;
+static const char * ring_name;
+static frame_ring * ring;
+static const char * http_addr;
+static int theme;
+static int realtime;
+static int realtime_cpu = -1;
+static const char * model_name;
+
+/* --realtime: the latest dumps, written only by the acquisition thread */
+static double late_us[JITTER_SAMPLES];
+static double capture_us[JITTER_SAMPLES];
+static uint64_t jitter_count;
+
+static struct client clients[MAX_CLIENTS];
+static int client_count;
+static uint64_t next_client_id = 1;
+
+/* hand-off from the acquisition thread to the main loop */
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct msg_buf * pending;
+static struct msg_buf * done;  /* replies, oldest first */
+static int wake_fd[2];
+
+/* commands waiting for the serial port, best candidate first */
+static pthread_mutex_t cmd_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cmd_cond;
+static struct command * commands;
+static int commands_queued;
+static int replugged;  /* the scope's device node reappeared */
+static uint64_t commands_received;
+
+static int before(const struct timespec * a, const struct timespec * b) {
+    return a->tv_sec < b->tv_sec
+	|| (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static double diff_us(const struct timespec * a, const struct timespec * b) {
+    return (a->tv_sec - b->tv_sec) * 1e6 + (a->tv_nsec - b->tv_nsec) / 1e3;
+}
+
+static void add_ms(struct timespec * t, long ms) {
+    t->tv_sec += ms / 1000;
+    t->tv_nsec += (ms % 1000) * 1000000;
+    if (t->tv_nsec >= 1000000000) {
+	t->tv_nsec -= 1000000000;
+	t->tv_sec++;
+    }
+}
+
+static void msg_unref(struct msg_buf * m) {
+    if (m && --m->refs == 0) {
+	free(m);
+    }
+}
+
+static struct msg_buf * msg_new(int type, size_t length) {
+    struct msg_buf * m;
+    struct proto_header * hdr;
+    struct timeval now;
+
+    m = malloc(sizeof(*m) + sizeof(*hdr) + length);
+    if (!m) {
+	return NULL;
+    }
+    gettimeofday(&now, NULL);
+    hdr = (struct proto_header *) m->data;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = PROTO_MAGIC;
+    hdr->type = type;
+    hdr->length = length;
+    hdr->timestamp = (uint64_t) now.tv_sec * 1000000 + now.tv_usec;
+    m->link = NULL;
+    m->client_id = 0;
+    m->size = sizeof(*hdr) + length;
+    m->refs = 1;
+    return m;
+}
+
+static struct msg_buf * reply_new(uint64_t client_id, uint64_t id,
+				  int status, const uint8_t * reply,
+				  size_t length) {
+    struct msg_buf * m = msg_new(MSG_REPLY, length);
+    struct proto_header * hdr;
+
+    if (!m) {
+	return NULL;
+    }
+    hdr = (struct proto_header *) m->data;
+    hdr->flags = status;
+    hdr->seq = id;
+    if (length) {
+	memcpy(m->data + sizeof(*hdr), reply, length);
+    }
+    m->client_id = client_id;
+    return m;
+}
+
+static void wake_main(void) {
+    if (write(wake_fd[1], "", 1) < 0) {
+	/* pipe already full, main loop will wake anyway */
+    }
+}
+
+/* acquisition thread: pass a command's outcome back to the main loop */
+static void post_reply(struct command * c, int status, const uint8_t * reply,
+		       size_t length) {
+    struct msg_buf * m = reply_new(c->client_id, c->id, status, reply, length);
+    struct msg_buf ** tail;
+
+    if (!m) {
+	return;
+    }
+    pthread_mutex_lock(&pending_lock);
+    for (tail = &done; *tail; tail = &(*tail)->link) {
+    }
+    *tail = m;
+    pthread_mutex_unlock(&pending_lock);
+    wake_main();
+}
+
+static void run_command(struct command * c) {
+    uint8_t reply[CMD_MAX];
+    struct timespec now;
+    int n;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (c->deadline.tv_sec && before(&c->deadline, &now)) {
+	post_reply(c, CMD_STATUS_EXPIRED, NULL, 0);
+	return;
+    }
+    if (!scope.connected) {
+	post_reply(c, CMD_STATUS_TIMEOUT, NULL, 0);
+	return;
+    }
+    n = serial_command(scope.fd, c->data, c->length,
+		       (c->flags & CMD_REPLY) ? reply : NULL, sizeof(reply),
+		       CMD_TIMEOUT);
+    if (n < 0) {
+	post_reply(c, CMD_STATUS_TIMEOUT, NULL, 0);
+    } else {
+	post_reply(c, CMD_STATUS_OK, reply, n);
+    }
+}
+
+/*
+ * may the best queued command run now? between dumps anything may, but once
+ * a dump is due only high priority commands, and a few normal ones, get to
+ * go first. low priority ones go once they have waited out CMD_LOW_WAIT
+ * dumps, so that back to back dumps (-p 0) don't starve them.
+ */
+static int command_runnable(const struct command * c, int dump_due,
+			    int burst, int dumps_waited) {
+    if (!dump_due) {
+	return 1;
+    }
+    switch (c->flags & CMD_PRIO_MASK) {
+    case CMD_PRIO_HIGH:
+	return 1;
+    case CMD_PRIO_NORMAL:
+	return burst < CMD_BURST;
+    default:
+	return dumps_waited >= CMD_LOW_WAIT;
+    }
+}
+
+/* with cmd_lock held: unlink commands whose deadline has passed */
+static struct command * take_expired(const struct timespec * now) {
+    struct command * expired = NULL, ** pos, * c;
+
+    for (pos = &commands; *pos;) {
+	c = *pos;
+	if (c->deadline.tv_sec && before(&c->deadline, now)) {
+	    *pos = c->link;
+	    commands_queued--;
+	    c->link = expired;
+	    expired = c;
+	} else {
+	    pos = &c->link;
+	}
+    }
+    return expired;
+}
+
+/* returns 0 if a frame was captured and passed on */
+static int capture_frame(void) {
+    const uint8_t * indexed = scope.indexed;
+    struct msg_buf * f, * old;
+    int was = scope.connected;
+
+    if (scope_capture(&scope)) {
+	if (was && !scope.connected) {
+	    printf("lost the scope, retrying\n");
+	}
+	return 1;
+    }
+    if (!was) {
+	printf("scope is back\n");
+    }
+    if (ring) {
+	ring_publish(ring, indexed, 0);
+    }
+    httpd_frame(indexed);
+    f = msg_new(MSG_FRAME, FRAME_PACKED_SIZE);
+    if (!f) {
+	return 0;
+    }
+    ((struct proto_header *) f->data)->seq = scope.seq;
+    decode_pack(indexed, f->data + sizeof(struct proto_header));
+
+    pthread_mutex_lock(&pending_lock);
+    old = pending;
+    pending = f;
+    pthread_mutex_unlock(&pending_lock);
+    free(old); /* never seen by the main loop */
+    wake_main();
+    return 0;
+}
+
+/*
+ * owns the serial port. screen dumps and client commands take turns here,
+ * one whole transaction at a time, so a command can delay a dump but never
+ * split one.
+ */
+static void * acquire_thread(void * arg) {
+    struct timespec next, now;
+    struct command * c, * expired;
+    struct timespec start;
+    int burst = 0, dumps_waited = 0, waiting = 0, err, rv;
+
+    if (realtime) {
+	if ((err = rt_pin_thread(realtime_cpu))) {
+	    printf("can't pin acquisition to CPU %d: %s\n", realtime_cpu,
+		   strerror(err));
+	}
+	if ((err = rt_set_fifo(RT_PRIORITY))) {
+	    printf("can't use SCHED_FIFO: %s\n", strerror(err));
+	}
+	rt_prefault(late_us, sizeof(late_us));
+	rt_prefault(capture_us, sizeof(capture_us));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!quit) {
+	pthread_mutex_lock(&cmd_lock);
+	while (1) {
+	    clock_gettime(CLOCK_MONOTONIC, &now);
+	    expired = take_expired(&now);
+	    if (replugged) {
+		replugged = 0;
+		scope_retry(&scope);
+		if (!scope.connected) {
+		    next = now;
+		}
+	    }
+	    c = commands;
+	    if (quit || expired) {
+		c = NULL;
+		break;
+	    }
+	    if (c && command_runnable(c, !before(&now, &next), burst,
+				      dumps_waited)) {
+		commands = c->link;
+		commands_queued--;
+		break;
+	    }
+	    if (!before(&now, &next)) {
+		waiting = c != NULL;
+		c = NULL; /* time for a dump */
+		break;
+	    }
+	    pthread_cond_timedwait(&cmd_cond, &cmd_lock, &next);
+	}
+	pthread_mutex_unlock(&cmd_lock);
+
+	if (expired) {
+	    while ((c = expired)) {
+		expired = c->link;
+		post_reply(c, CMD_STATUS_EXPIRED, NULL, 0);
+		free(c);
+	    }
+	    continue;
+	}
+	if (quit) {
+	    break;
+	}
+
+	if (c) {
+	    run_command(c);
+	    free(c);
+	    burst++;
+	    dumps_waited = 0;
+	    continue;
+	}
+	dumps_waited = waiting ? dumps_waited + 1 : 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	rv = capture_frame();
+	burst = 0;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (realtime && !rv) {
+	    late_us[jitter_count % JITTER_SAMPLES] = diff_us(&start, &next);
+	    capture_us[jitter_count % JITTER_SAMPLES] = diff_us(&now, &start);
+	    jitter_count++;
+	}
+	add_ms(&next, period);
+	if (before(&next, &now)) {
+	    next = now; /* fell behind, don't try to catch up */
+	}
+	if (!scope.connected && before(&next, &scope.retry)) {
+	    next = scope.retry; /* nothing to poll until then */
+	}
+    }
+    return NULL;
+}
+
+/* sort order of the command queue */
+static int command_before(const struct command * a, const struct command * b) {
+    int pa = a->flags & CMD_PRIO_MASK, pb = b->flags & CMD_PRIO_MASK;
+
+    if (pa != pb) {
+	return pa > pb;
+    }
+    if (a->deadline.tv_sec != 0 && b->deadline.tv_sec == 0) {
+	return 1;
+    }
+    if (a->deadline.tv_sec != 0 && before(&a->deadline, &b->deadline)) {
+	return 1;
+    }
+    if (b->deadline.tv_sec != 0 && (a->deadline.tv_sec == 0
+				    || before(&b->deadline, &a->deadline))) {
+	return 0;
+    }
+    return a->order < b->order;
+}
+
+static void client_push_reply(struct client * c, struct msg_buf * m) {
+    struct msg_buf ** tail;
+
+    if (!c->cur) {
+	c->cur = m;
+	c->off = 0;
+	return;
+    }
+    for (tail = &c->replies; *tail; tail = &(*tail)->link) {
+    }
+    *tail = m;
+}
+
+/* main thread: queue a command received from a client */
+static void submit_command(struct client * cl) {
+    struct command * c, ** pos;
+    int status = CMD_STATUS_OK;
+    struct msg_buf * m;
+    int queued;
+
+    /* only this thread adds commands, so the count can only drop after this */
+    pthread_mutex_lock(&cmd_lock);
+    queued = commands_queued;
+    pthread_mutex_unlock(&cmd_lock);
+
+    if (cl->rx_hdr.type != MSG_COMMAND || cl->rx_hdr.length == 0) {
+	status = CMD_STATUS_INVALID;
+    } else if (queued >= CMD_QUEUE_MAX
+	       || !(c = malloc(sizeof(*c)))) {
+	status = CMD_STATUS_BUSY;
+    }
+    if (status != CMD_STATUS_OK) {
+	m = reply_new(cl->id, cl->rx_hdr.seq, status, NULL, 0);
+	if (m) {
+	    client_push_reply(cl, m);
+	}
+	return;
+    }
+
+    c->client_id = cl->id;
+    c->id = cl->rx_hdr.seq;
+    c->flags = cl->rx_hdr.flags;
+    c->deadline.tv_sec = 0;
+    c->deadline.tv_nsec = 0;
+    if (cl->rx_hdr.arg) {
+	clock_gettime(CLOCK_MONOTONIC, &c->deadline);
+	add_ms(&c->deadline, cl->rx_hdr.arg);
+    }
+    c->order = commands_received++;
+    c->length = cl->rx_hdr.length;
+    memcpy(c->data, cl->rx_data, c->length);
+
+    pthread_mutex_lock(&cmd_lock);
+    for (pos = &commands; *pos && command_before(*pos, c);
+	 pos = &(*pos)->link) {
+    }
+    c->link = *pos;
+    *pos = c;
+    commands_queued++;
+    pthread_cond_signal(&cmd_cond);
+    pthread_mutex_unlock(&cmd_lock);
+}
+
+static void client_drop(int i) {
+    struct command ** pos, * c;
+    struct msg_buf * m;
+
+    /* forget commands nobody is waiting for anymore */
+    pthread_mutex_lock(&cmd_lock);
+    for (pos = &commands; *pos;) {
+	if ((*pos)->client_id == clients[i].id) {
+	    c = *pos;
+	    *pos = c->link;
+	    commands_queued--;
+	    free(c);
+	} else {
+	    pos = &(*pos)->link;
+	}
+    }
+    pthread_mutex_unlock(&cmd_lock);
+
+    close(clients[i].fd);
+    msg_unref(clients[i].cur);
+    msg_unref(clients[i].next);
+    while ((m = clients[i].replies)) {
+	clients[i].replies = m->link;
+	msg_unref(m);
+    }
+    clients[i] = clients[--client_count];
+}
+
+/* send as much as the socket takes, returns nonzero if the client is gone */
+static int client_flush(struct client * c) {
+    ssize_t n;
+
+    while (c->cur) {
+	n = send(c->fd, c->cur->data + c->off, c->cur->size - c->off,
+		 MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (n < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return !(errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+	c->off += n;
+	if (c->off == c->cur->size) {
+	    msg_unref(c->cur);
+	    c->off = 0;
+	    if (c->replies) {
+		c->cur = c->replies;
+		c->replies = c->cur->link;
+	    } else {
+		c->cur = c->next;
+		c->next = NULL;
+	    }
+	}
+    }
+    return 0;
+}
+
+/* read whatever the client sent, returns nonzero if it should be dropped */
+static int client_read(struct client * c) {
+    uint8_t * dst;
+    size_t want;
+    ssize_t n;
+
+    while (1) {
+	if (c->rx_have < sizeof(c->rx_hdr)) {
+	    dst = (uint8_t *) &c->rx_hdr + c->rx_have;
+	    want = sizeof(c->rx_hdr) - c->rx_have;
+	} else {
+	    dst = c->rx_data + (c->rx_have - sizeof(c->rx_hdr));
+	    want = c->rx_hdr.length - (c->rx_have - sizeof(c->rx_hdr));
+	}
+	if (want) {
+	    n = read(c->fd, dst, want);
+	    if (n == 0) {
+		return 1;
+	    } else if (n < 0) {
+		if (errno == EINTR) {
+		    continue;
+		}
+		return !(errno == EAGAIN || errno == EWOULDBLOCK);
+	    }
+	    c->rx_have += n;
+	}
+	if (c->rx_have == sizeof(c->rx_hdr)
+	    && (c->rx_hdr.magic != PROTO_MAGIC
+		|| c->rx_hdr.length > CMD_MAX)) {
+	    return 1;
+	}
+	if (c->rx_have >= sizeof(c->rx_hdr)
+	    && c->rx_have == sizeof(c->rx_hdr) + c->rx_hdr.length) {
+	    submit_command(c);
+	    c->rx_have = 0;
+	}
+    }
+}
+
+static void client_queue(struct client * c, struct msg_buf * f) {
+    f->refs++;
+    if (!c->cur) {
+	c->cur = f;
+	c->off = 0;
+    } else {
+	if (c->next) {
+	    msg_unref(c->next);
+	    c->skipped++;
+	}
+	c->next = f;
+    }
+}
+
+static struct client * client_by_id(uint64_t id) {
+    int i;
+
+    for (i = 0; i < client_count; i++) {
+	if (clients[i].id == id) {
+	    return &clients[i];
+	}
+    }
+    return NULL;
+}
+
+static void broadcast_pending(void) {
+    struct msg_buf * f, * replies, * m;
+    struct client * c;
+    char drain[64];
+    int i;
+
+    while (read(wake_fd[0], drain, sizeof(drain)) > 0) {
+    }
+    pthread_mutex_lock(&pending_lock);
+    f = pending;
+    pending = NULL;
+    replies = done;
+    done = NULL;
+    pthread_mutex_unlock(&pending_lock);
+
+    while ((m = replies)) {
+	replies = m->link;
+	m->link = NULL;
+	c = client_by_id(m->client_id);
+	if (c) {
+	    client_push_reply(c, m);
+	} else {
+	    msg_unref(m);
+	}
+    }
+    for (i = client_count - 1; i >= 0; i--) {
+	if (f) {
+	    client_queue(&clients[i], f);
+	}
+	if (client_flush(&clients[i])) {
+	    client_drop(i);
+	}
+    }
+    msg_unref(f);
+}
+
+static void accept_clients(int listen_fd) {
+    int sndbuf = sizeof(struct proto_header) + FRAME_PACKED_SIZE;
+    int fd;
+
+    while ((fd = accept(listen_fd, NULL, NULL)) != -1) {
+	if (client_count == MAX_CLIENTS) {
+	    close(fd);
+	    continue;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	/* keep the kernel from queueing many stale frames for slow clients */
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	memset(&clients[client_count], 0, sizeof(struct client));
+	clients[client_count].fd = fd;
+	clients[client_count++].id = next_client_id++;
+    }
+}
+
+static int listen_init(const char * path) {
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+	return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* remove a stale socket left by a previous run, but nothing else */
+    if (!stat(path, &st) && S_ISSOCK(st.st_mode)) {
+	unlink(path);
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+	return -1;
+    }
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr))
+	|| listen(fd, 16)) {
+	close(fd);
+	return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static void on_signal(int sig) {
+    quit = 1;
+}
+
+static void main_loop(int listen_fd) {
+    struct pollfd fds[MAX_CLIENTS + 3 + HTTPD_MAX_FDS];
+    int i, n, http, watch;
+
+    while (!quit) {
+	fds[0].fd = listen_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = wake_fd[0];
+	fds[1].events = POLLIN;
+	for (i = 0; i < client_count; i++) {
+	    fds[i + 2].fd = clients[i].fd;
+	    fds[i + 2].events = POLLIN | (clients[i].cur ? POLLOUT : 0);
+	}
+	n = client_count;
+	http = httpd_pollfds(fds + n + 2);
+	watch = n + 2 + http;
+	fds[watch].fd = scope.watch;  /* ignored if -1 */
+	fds[watch].events = POLLIN;
+	if (poll(fds, watch + 1, -1) < 0) {
+	    continue; /* EINTR, check quit */
+	}
+
+	/* walk backwards so dropping a client doesn't skip another */
+	for (i = n - 1; i >= 0; i--) {
+	    if (fds[i + 2].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+		client_drop(i);
+	    } else if (fds[i + 2].revents & POLLIN
+		       && client_read(&clients[i])) {
+		client_drop(i);
+	    } else if (client_flush(&clients[i])) {
+		client_drop(i); /* sends replies to new commands, too */
+	    }
+	}
+	if (fds[1].revents & POLLIN) {
+	    broadcast_pending();
+	}
+	if (fds[0].revents & POLLIN) {
+	    accept_clients(listen_fd);
+	}
+	httpd_dispatch(fds + n + 2, http);
+	if (fds[watch].revents & POLLIN && scope_watch_event(&scope)) {
+	    pthread_mutex_lock(&cmd_lock);
+	    replugged = 1;
+	    pthread_cond_signal(&cmd_cond);
+	    pthread_mutex_unlock(&cmd_lock);
+	}
+    }
+}
+
+void usage(const char * name) {
+    printf("usage: %s [options] <serial-device>\n", name);
+    printf("  -p, --period=MS       milliseconds between polling scope"
+	   " (default %d, 0 = back to back)\n", UPDATE_PERIOD);
+    printf("  -l, --listen=PATH     Unix socket to serve clients on"
+	   " (default %s)\n", PROTO_DEFAULT_SOCKET);
+    printf("  -s, --shm[=NAME]      also publish frames to shared memory ring"
+	   " NAME (default %s)\n", RING_DEFAULT_NAME);
+    printf("  -w, --http=PORT|PATH  serve the live view over HTTP on"
+	   " 127.0.0.1:PORT or a Unix socket\n");
+    printf("  -t, --theme=NAME      color theme for HTTP images"
+	   " (dark, light, mono, orig) or palette file\n");
+    printf("  -m, --model=NAME|auto scope model (default GDS-820C), auto asks"
+	   " the scope\n");
+    printf("  -R, --realtime[=CPU]  lock memory, pin acquisition to CPU"
+	   " (default last) at SCHED_FIFO\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option options[] = {
+	{"period", required_argument, NULL, 'p'},
+	{"listen", required_argument, NULL, 'l'},
+	{"shm", optional_argument, NULL, 's'},
+	{"http", required_argument, NULL, 'w'},
+	{"theme", required_argument, NULL, 't'},
+	{"realtime", optional_argument, NULL, 'R'},
+	{"model", required_argument, NULL, 'm'},
+	{"help", no_argument, NULL, 'h'},
+	{NULL, 0, NULL, 0}};
+    struct sigaction sa;
+    pthread_condattr_t attr;
+    sigset_t block, old;
+    pthread_t thread;
+    struct msg_buf * m;
+    struct command * c;
+    const scope_model * model = &scope_models[MODEL_DEFAULT];
+    int opt, listen_fd, i, auto_model = 0;
+
+    while ((opt = getopt_long(argc, argv, "p:l:sw:t:Rm:h", options, NULL))
+	   != -1) {
+	switch (opt) {
+	case 'p':
+	    period = atoi(optarg);
+	    break;
+	case 'l':
+	    socket_path = optarg;
+	    break;
+	case 's':
+	    ring_name = optarg ? optarg : RING_DEFAULT_NAME;
+	    break;
+	case 'w':
+	    http_addr = optarg;
+	    break;
+	case 't':
+	    theme = palette_select(optarg);
+	    break;
+	case 'm':
+	    model_name = optarg;
+	    break;
+	case 'R':
+	    realtime = 1;
+	    realtime_cpu = optarg ? atoi(optarg) : rt_last_cpu();
+	    break;
+	default:
+	    usage(argv[0]);
+	    return 1;
+	}
+    }
+    if (model_name && !strcmp(model_name, "auto")) {
+	auto_model = 1;
+    } else if (model_name && !(model = model_find(model_name))) {
+	printf("unknown model %s\n", model_name);
+	return 1;
+    }
+    if (optind >= argc || period < 0 || theme < 0) {
+	usage(argv[0]);
+	return 1;
+    }
+    if (realtime && (i = rt_lock_memory(RT_HEAP_PREFAULT))) {
+	printf("can't lock memory: %s\n", strerror(i));
+    }
+
+    /* initialize serial port */
+    if (scope_open_model(&scope, argv[optind], model)) {
+	printf ("error opening serial port\n");
+	return 1;
+    }
+    if (auto_model && scope_identify(&scope)) {
+	printf ("scope didn't say which model it is, assuming %s\n",
+		scope.model->name);
+    }
+    scope_watch(&scope); /* without it, replugs are found by polling */
+
+    if (ring_name) {
+	ring = ring_create(ring_name, RING_DEFAULT_SLOTS);
+	if (!ring) {
+	    printf ("error creating shared memory ring %s\n", ring_name);
+	    return 1;
+	}
+    }
+
+    listen_fd = listen_init(socket_path);
+    if (listen_fd == -1) {
+	printf ("error listening on %s\n", socket_path);
+	return 1;
+    }
+    if (http_addr && httpd_init(http_addr, theme)) {
+	printf ("error serving HTTP on %s\n", http_addr);
+	return 1;
+    }
+    if (pipe(wake_fd)) {
+	printf ("error creating wake pipe\n");
+	return 1;
+    }
+    fcntl(wake_fd[0], F_SETFL, fcntl(wake_fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_fd[1], F_SETFL, fcntl(wake_fd[1], F_GETFL) | O_NONBLOCK);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cmd_cond, &attr);
+
+    /* only the main thread handles signals, so poll() sees EINTR */
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    if (pthread_create(&thread, NULL, acquire_thread, NULL)) {
+	printf ("error starting acquisition thread\n");
+	return 1;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    main_loop(listen_fd);
+
+    /* clean up and exit */
+    pthread_mutex_lock(&cmd_lock);
+    pthread_cond_signal(&cmd_cond);
+    pthread_mutex_unlock(&cmd_lock);
+    pthread_join(thread, NULL);
+    if (jitter_count) {
+	i = jitter_count < JITTER_SAMPLES ? jitter_count : JITTER_SAMPLES;
+	stats_report(stdout, "dump lateness", "us", late_us, i);
+	stats_report(stdout, "dump duration", "us", capture_us, i);
+    }
+    httpd_shutdown();
+    for (i = client_count - 1; i >= 0; i--) {
+	client_drop(i);
+    }
+    free(pending);
+    while ((m = done)) {
+	done = m->link;
+	free(m);
+    }
+    while ((c = commands)) {
+	commands = c->link;
+	free(c);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+    ring_close(ring, ring_name);
+    scope_close(&scope);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * About : Serial link to the GDS-820C, shared by the viewer and the daemon.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include "decode.h"
+#include "serial.h"
+#include "trace.h"
+
+static const uint8_t msg[] = { 0x57, 0x00, 0x00, 0x0A } ; /* screen capture request */
+
+int serial_init(const char * dev) {
+    struct termios tio;
+    int console_fd;
+
+    memset(&tio, 0, sizeof(tio));
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_cflag = CS8 | CREAD | CLOCAL; /* 8N1, see termios.h for more info */
+    tio.c_lflag = 0;
+
+    console_fd = open(dev, O_RDWR);
+    if (console_fd == -1) {
+	return 0; /* error */
+    }
+
+    cfsetospeed(&tio, B1200);
+    cfsetispeed(&tio, B1200);
+
+    tcsetattr(console_fd, TCSANOW, &tio);
+
+    return console_fd;
+}
+
+/*
+ * send request and read back a screen dump of exactly size bytes. returns
+ * 0 with the dump in buffer, SERIAL_GONE if the device was unplugged or
+ * switched off, 1 on any other failure. seq only tags the tracepoints, see
+ * trace.h.
+ */
+uint8_t serial_acquire(int console_fd, const uint8_t * request,
+		       size_t request_length, uint8_t * buffer, size_t size,
+		       uint64_t seq) {
+    uint8_t * buffer_index = &buffer[0];
+    uint8_t temp_buffer[64];
+    fd_set set;
+    struct timeval timeout;
+    int rv, rval;
+    size_t total = 0;
+
+    /* request data */
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RX_TIMEOUT;
+    FD_ZERO(&set);
+    FD_SET(console_fd, &set);
+    rval = write(console_fd, request, request_length);
+    if (rval != (int) request_length) {
+	return rval == -1 && errno != EINTR && errno != EAGAIN ? SERIAL_GONE : 1;
+    }
+    TRACE(frame_request, seq);
+
+    while (1) {
+	rv = select(console_fd + 1, &set, NULL, NULL, &timeout);
+	if (rv == -1) {
+	    /* error? */
+	    return 1;
+	} else if (rv == 0) {
+	    /* timeout */
+	    return 1;
+	} else {
+	    rval = read(console_fd, &temp_buffer, 64);
+	    if (rval > 0) {
+		if (!total) {
+		    TRACE(frame_first_byte, seq);
+		}
+		total += rval;
+		if (total <= size) {
+		    memcpy(buffer_index, &temp_buffer, rval);
+		    buffer_index += rval;
+		} else {
+		    printf(">> overflow: last rval=%d, bytes total=%zu\n", rval, total);
+		    return 1;
+		}
+		if (total == size) {
+		    /* just the exact amount of data we wanted */
+		    TRACE(frame_complete, seq);
+		    return 0;
+		}
+	    } else if (rval == 0 || (errno != EINTR && errno != EAGAIN)) {
+		/* readable but nothing there: hung up, usually EIO */
+		return SERIAL_GONE;
+	    }
+	}
+    }
+}
+
+/* a GDS-820C screen dump, see model.h for the others */
+uint8_t acquire_scope_buffer(int console_fd, uint8_t * buffer, uint64_t seq) {
+    return serial_acquire(console_fd, msg, sizeof(msg), buffer,
+			  SCREEN_DUMP_SIZE, seq);
+}
+
+/*
+ * send a command and, if reply is given, read back one line of answer.
+ * returns the reply length (0 if none was wanted) or -1 on timeout.
+ */
+int serial_command(int console_fd, const uint8_t * cmd, size_t length,
+		   uint8_t * reply, size_t reply_max, long timeout_us) {
+    fd_set set;
+    struct timeval timeout;
+    size_t total = 0;
+    int rv, rval;
+
+    /* drop anything left over from an aborted transfer */
+    tcflush(console_fd, TCIFLUSH);
+    if (write(console_fd, cmd, length) != (ssize_t) length) {
+	return -1;
+    }
+    if (!reply) {
+	tcdrain(console_fd);
+	return 0;
+    }
+
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_usec = timeout_us % 1000000;
+    while (total < reply_max) {
+	FD_ZERO(&set);
+	FD_SET(console_fd, &set);
+	rv = select(console_fd + 1, &set, NULL, NULL, &timeout);
+	if (rv <= 0) {
+	    return -1;
+	}
+	rval = read(console_fd, reply + total, 1);
+	if (rval > 0) {
+	    total += rval;
+	    if (reply[total - 1] == '\n') {
+		break;
+	    }
+	}
+    }
+    return total;
+}
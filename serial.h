@@ -0,0 +1,23 @@
+/*
+ * About : Serial link to the GDS-820C, see serial.c.
+ */
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RX_TIMEOUT 200000  /* microseconds to wait for a screen dump */
+#define CMD_TIMEOUT 500000  /* microseconds to wait for a command reply */
+#define SERIAL_GONE 2  /* acquire_scope_buffer(): the device went away */
+
+int serial_init(const char * dev);
+uint8_t serial_acquire(int console_fd, const uint8_t * request,
+		       size_t request_length, uint8_t * buffer, size_t size,
+		       uint64_t seq);
+uint8_t acquire_scope_buffer(int console_fd, uint8_t * buffer, uint64_t seq);
+int serial_command(int console_fd, const uint8_t * cmd, size_t length,
+		   uint8_t * reply, size_t reply_max, long timeout_us);
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * About : Seqlocked shared-memory frame ring, see shmring.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "decode.h"
+#include "shmring.h"
+
+#define SLOT_ALIGN 64  /* keep slot headers on their own cache line */
+#define RING_CREATE_TRIES 10
+#define RING_CREATE_WAIT 10000  /* microseconds between tries */
+
+static struct ring_slot * slot_at(frame_ring * ring, uint64_t frame) {
+    uint8_t * base = (uint8_t *) ring->hdr + sizeof(struct ring_header);
+    return (struct ring_slot *)
+	(base + (frame % ring->hdr->slot_count) * ring->hdr->slot_size);
+}
+
+/*
+ * who has the existing ring called name: RING_DEAD once its writer_pid has
+ * gone, RING_LIVE while it runs, RING_UNSURE if it is gone itself or still
+ * being set up by a writer that has not got to writer_pid and magic yet.
+ */
+enum { RING_LIVE, RING_DEAD, RING_UNSURE };
+static int ring_writer(const char * name) {
+    struct ring_header * hdr;
+    struct stat st;
+    pid_t pid;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+	return errno == ENOENT ? RING_UNSURE : RING_LIVE;
+    }
+    if (fstat(fd, &st)) {
+	close(fd);
+	return RING_LIVE;
+    }
+    if (st.st_size < (off_t) sizeof(struct ring_header)) {
+	close(fd);
+	return RING_UNSURE;
+    }
+    hdr = mmap(NULL, sizeof(*hdr), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+	return RING_LIVE;
+    }
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != RING_MAGIC) {
+	munmap(hdr, sizeof(*hdr));
+	return RING_UNSURE;
+    }
+    pid = hdr->writer_pid;
+    munmap(hdr, sizeof(*hdr));
+    if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+	return RING_DEAD;
+    }
+    return RING_LIVE;
+}
+
+frame_ring * ring_create(const char * name, uint32_t slot_count) {
+    frame_ring * ring;
+    uint32_t slot_size;
+    int fd, tries, state;
+
+    if (slot_count < 2) {
+	return NULL;
+    }
+    slot_size = sizeof(struct ring_slot) + FRAME_PIXELS;
+    slot_size = (slot_size + SLOT_ALIGN - 1) & ~(SLOT_ALIGN - 1);
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+	return NULL;
+    }
+    ring->size = sizeof(struct ring_header) + (size_t) slot_count * slot_size;
+    ring->writer = 1;
+
+    /*
+     * never truncate a ring another writer may be publishing to. only one
+     * whose writer is known to be gone is replaced, one being set up gets
+     * a moment to finish before we give up on the name.
+     */
+    for (tries = 0;; tries++) {
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd != -1 || errno != EEXIST || tries == RING_CREATE_TRIES) {
+	    break;
+	}
+	state = ring_writer(name);
+	if (state == RING_LIVE) {
+	    break;
+	} else if (state == RING_DEAD) {
+	    shm_unlink(name);
+	} else {
+	    usleep(RING_CREATE_WAIT);
+	}
+    }
+    if (fd == -1) {
+	free(ring);
+	return NULL;
+    }
+    if (ftruncate(fd, ring->size)) {
+	shm_unlink(name);
+	close(fd);
+	free(ring);
+	return NULL;
+    }
+    ring->hdr = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     fd, 0);
+    close(fd);
+    if (ring->hdr == MAP_FAILED) {
+	shm_unlink(name);
+	free(ring);
+	return NULL;
+    }
+
+    ring->hdr->version = RING_VERSION;
+    ring->hdr->slot_count = slot_count;
+    ring->hdr->slot_size = slot_size;
+    ring->hdr->width = FRAME_WIDTH;
+    ring->hdr->height = FRAME_HEIGHT;
+    ring->hdr->writer_pid = getpid();
+    /* readers check the magic last, once the rest is valid */
+    __atomic_store_n(&ring->hdr->magic, RING_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+void ring_publish(frame_ring * ring, const uint8_t * indexed, uint32_t theme) {
+    uint64_t frame = ring->hdr->head + 1;
+    struct ring_slot * slot = slot_at(ring, frame);
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    __atomic_store_n(&slot->seq, 2 * frame - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->timestamp = (uint64_t) now.tv_sec * 1000000 + now.tv_usec;
+    slot->theme = theme;
+    memcpy(slot + 1, indexed, FRAME_PIXELS);
+    __atomic_store_n(&slot->seq, 2 * frame, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->hdr->head, frame, __ATOMIC_RELEASE);
+}
+
+frame_ring * ring_open(const char * name) {
+    frame_ring * ring;
+    struct stat st;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+	return NULL;
+    }
+    if (fstat(fd, &st) || st.st_size < (off_t) sizeof(struct ring_header)) {
+	close(fd);
+	return NULL;
+    }
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+	close(fd);
+	return NULL;
+    }
+    ring->size = st.st_size;
+    ring->hdr = mmap(NULL, ring->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring->hdr == MAP_FAILED) {
+	free(ring);
+	return NULL;
+    }
+    if (__atomic_load_n(&ring->hdr->magic, __ATOMIC_ACQUIRE) != RING_MAGIC
+	|| ring->hdr->version != RING_VERSION
+	|| ring->hdr->slot_count == 0
+	|| ring->hdr->slot_size < sizeof(struct ring_slot) + FRAME_PIXELS
+	|| ring->size < sizeof(struct ring_header)
+	   + (size_t) ring->hdr->slot_count * ring->hdr->slot_size) {
+	munmap(ring->hdr, ring->size);
+	free(ring);
+	return NULL;
+    }
+    return ring;
+}
+
+uint64_t ring_latest(frame_ring * ring) {
+    return __atomic_load_n(&ring->hdr->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * start a zero-copy read of a frame. returns a pointer to its pixels inside
+ * the ring, or NULL if the frame is not (or no longer) in the ring. whatever
+ * was looked at must be discarded unless ring_end_read() returns 0.
+ */
+const uint8_t * ring_begin_read(frame_ring * ring, uint64_t frame,
+				const struct ring_slot ** slot) {
+    struct ring_slot * s;
+
+    if (frame == 0) {
+	return NULL;
+    }
+    s = slot_at(ring, frame);
+    if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != 2 * frame) {
+	return NULL;
+    }
+    if (slot) {
+	*slot = s;
+    }
+    return (const uint8_t *) (s + 1);
+}
+
+int ring_end_read(frame_ring * ring, uint64_t frame) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot_at(ring, frame)->seq, __ATOMIC_RELAXED)
+	!= 2 * frame) {
+	return 1; /* overwritten while we were reading */
+    }
+    return 0;
+}
+
+/* copy a frame out of the ring, returns 0 on success */
+int ring_read(frame_ring * ring, uint64_t frame, uint8_t * indexed,
+	      uint64_t * timestamp) {
+    const struct ring_slot * slot;
+    const uint8_t * pixels;
+    uint64_t ts;
+
+    pixels = ring_begin_read(ring, frame, &slot);
+    if (!pixels) {
+	return 1;
+    }
+    ts = slot->timestamp;
+    memcpy(indexed, pixels, FRAME_PIXELS);
+    if (ring_end_read(ring, frame)) {
+	return 1;
+    }
+    if (timestamp) {
+	*timestamp = ts;
+    }
+    return 0;
+}
+
+void ring_close(frame_ring * ring, const char * name) {
+    if (!ring) {
+	return;
+    }
+    munmap(ring->hdr, ring->size);
+    if (ring->writer && name) {
+	shm_unlink(name);
+    }
+    free(ring);
+}
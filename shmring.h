@@ -0,0 +1,74 @@
+/*
+ * About : POSIX shared-memory ring of indexed frames for local consumers.
+ *
+ * Notes :
+ *
+ * The writer (scopeview) creates a shared memory object, by default
+ * /dev/shm/scopeview, laid out as one ring_header followed by slot_count
+ * slots of slot_size bytes. Each slot starts with a ring_slot header and is
+ * followed by width*height bytes of indexed pixels (see decode.h).
+ *
+ * Frames are numbered from 1 and frame n lives in slot n % slot_count. Each
+ * slot is protected by a seqlock: seq is 2n-1 while frame n is being written
+ * and 2n once it is complete. Readers map the object read-only and never
+ * block the writer. A read is valid if seq was 2n both before and after the
+ * pixels were looked at, so readers can work on the pixels in place and only
+ * copy (or retry) if they need a stable picture.
+ *
+ * A writer never takes over a ring unless its writer_pid is known to have
+ * exited. Such a ring is unlinked and created afresh, so readers that still
+ * have the old one mapped keep a valid (if idle) mapping.
+ *
+ * All fields are native endian, for consumers on the same machine.
+ */
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RING_MAGIC 0x31525653  /* "SVR1" */
+#define RING_VERSION 1
+#define RING_DEFAULT_NAME "/scopeview"
+#define RING_DEFAULT_SLOTS 8
+
+struct ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;  /* bytes per slot including its header */
+    uint32_t width;
+    uint32_t height;
+    uint64_t head;  /* number of the latest complete frame, 0 if none */
+    uint32_t writer_pid;  /* process publishing to the ring */
+    uint8_t pad[28];
+};
+
+struct ring_slot {
+    uint64_t seq;  /* seqlock, see above */
+    uint64_t timestamp;  /* capture time, microseconds since the epoch */
+    uint32_t theme;  /* color theme selected in the viewer at capture */
+    uint8_t pad[44];
+};
+
+typedef struct {
+    struct ring_header *hdr;
+    size_t size;
+    int writer;
+} frame_ring;
+
+frame_ring * ring_create(const char * name, uint32_t slot_count);
+void ring_publish(frame_ring * ring, const uint8_t * indexed, uint32_t theme);
+
+frame_ring * ring_open(const char * name);
+uint64_t ring_latest(frame_ring * ring);
+const uint8_t * ring_begin_read(frame_ring * ring, uint64_t frame,
+				const struct ring_slot ** slot);
+int ring_end_read(frame_ring * ring, uint64_t frame);
+int ring_read(frame_ring * ring, uint64_t frame, uint8_t * indexed,
+	      uint64_t * timestamp);
+
+void ring_close(frame_ring * ring, const char * name);
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * About : Summaries of timing samples: percentiles, spread and a histogram.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+#define HISTOGRAM_BINS 10
+#define HISTOGRAM_WIDTH 40
+
+static int compare_double(const void * a, const void * b) {
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double * sorted, int count, double p) {
+    return sorted[(int) (p * (count - 1) + 0.5)];
+}
+
+/* summarize samples, sorting them in place. returns 1 if there are none */
+int stats_summarize(double * samples, int count, stats_summary * s) {
+    double sum = 0, sq = 0;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    if (count < 1) {
+	return 1;
+    }
+    qsort(samples, count, sizeof(double), compare_double);
+    for (i = 0; i < count; i++) {
+	sum += samples[i];
+    }
+    s->mean = sum / count;
+    for (i = 0; i < count; i++) {
+	sq += (samples[i] - s->mean) * (samples[i] - s->mean);
+    }
+    s->count = count;
+    s->stddev = sqrt(sq / count);
+    s->min = samples[0];
+    s->max = samples[count - 1];
+    s->p50 = percentile(samples, count, 0.50);
+    s->p90 = percentile(samples, count, 0.90);
+    s->p99 = percentile(samples, count, 0.99);
+    return 0;
+}
+
+/* print a summary and a histogram of samples (sorted in place) */
+void stats_report(FILE * f, const char * label, const char * unit,
+		  double * samples, int count) {
+    int bins[HISTOGRAM_BINS] = {0};
+    double width;
+    stats_summary s;
+    int i, b, most = 0;
+
+    if (stats_summarize(samples, count, &s)) {
+	fprintf(f, "%s: no samples\n", label);
+	return;
+    }
+    fprintf(f, "%s (%d samples, %s)\n", label, s.count, unit);
+    fprintf(f, "  min %.1f  mean %.1f  stddev %.1f  max %.1f\n",
+	    s.min, s.mean, s.stddev, s.max);
+    fprintf(f, "  p50 %.1f  p90 %.1f  p99 %.1f\n", s.p50, s.p90, s.p99);
+    if (s.max == s.min) {
+	return;
+    }
+
+    width = (s.max - s.min) / HISTOGRAM_BINS;
+    for (i = 0; i < count; i++) {
+	b = (int) ((samples[i] - s.min) / width);
+	bins[b < HISTOGRAM_BINS ? b : HISTOGRAM_BINS - 1]++;
+    }
+    for (b = 0; b < HISTOGRAM_BINS; b++) {
+	most = bins[b] > most ? bins[b] : most;
+    }
+    for (b = 0; b < HISTOGRAM_BINS; b++) {
+	fprintf(f, "  %10.1f %6d ", s.min + b * width, bins[b]);
+	for (i = 0; i < bins[b] * HISTOGRAM_WIDTH / most; i++) {
+	    fputc('#', f);
+	}
+	fputc('\n', f);
+    }
+}
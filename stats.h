@@ -0,0 +1,20 @@
+/*
+ * About : Summaries of timing samples, see stats.c.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+typedef struct {
+    int count;
+    double min, max, mean, stddev;
+    double p50, p90, p99;
+} stats_summary;
+
+int stats_summarize(double * samples, int count, stats_summary * s);
+void stats_report(FILE * f, const char * label, const char * unit,
+		  double * samples, int count);
+
+#endif
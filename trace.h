@@ -0,0 +1,41 @@
+/*
+ * About : Static tracepoints on the capture and render paths.
+ *
+ * Notes :
+ *
+ * Built with "make TRACE=1", every TRACE() is a USDT probe of provider
+ * scopeview (needs <sys/sdt.h>, from systemtap-sdt-dev or similar), which
+ * perf and bpftrace can attach to without a rebuild, and which costs a nop
+ * while nobody is. Without it they compile to nothing.
+ *
+ * Every probe's one argument is the frame sequence number, so one frame
+ * can be followed from request to screen:
+ *
+ *     frame_request     dump asked for        (serial.c)
+ *     frame_first_byte  first byte of it in
+ *     frame_complete    all of it in
+ *     decode_start      rotation to indices   (scope.c, scopeview.c)
+ *     decode_end
+ *     scale_start       scaling to the window (scopeview.c)
+ *     scale_end
+ *     present           handed to GTK
+ *
+ * The serial.c and scope.c probes are in libscopeview, so they fire in
+ * scopeviewd as well, through scope_capture().
+ *
+ * e.g. bpftrace -e 'usdt:./scopeview:scopeview:frame_request
+ *     { @t[arg0] = nsecs } usdt:./scopeview:scopeview:present
+ *     /@t[arg0]/ { @ms = hist((nsecs - @t[arg0]) / 1000000) }'
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef SCOPEVIEW_TRACE
+#include <sys/sdt.h>
+#define TRACE(probe, seq) DTRACE_PROBE1(scopeview, probe, (uint64_t) (seq))
+#else
+#define TRACE(probe, seq) do { } while (0)
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * About : Readout values over time, see trend.h.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "trend.h"
+
+/* append a bucket to a level, returns nonzero if out of memory */
+static int push(trend_series * s, int k, const struct trend_bucket * b) {
+    struct trend_bucket * grown;
+    size_t size;
+
+    if (s->count[k] == s->size[k]) {
+	size = s->size[k] ? s->size[k] * 2 : 256;
+	grown = realloc(s->level[k], size * sizeof(*grown));
+	if (!grown) {
+	    return 1;
+	}
+	s->level[k] = grown;
+	s->size[k] = size;
+    }
+    s->level[k][s->count[k]++] = *b;
+    return 0;
+}
+
+/*
+ * add a point, NaNs (unreadable readouts) are left out. a timestamp older
+ * than the last point's is taken as the same time. returns 0 on success.
+ */
+int trend_add(trend_series * s, uint64_t timestamp, double value) {
+    struct trend_bucket b, * below;
+    int k, i;
+
+    if (isnan(value)) {
+	return 0;
+    }
+    if (s->count[0] && timestamp < s->level[0][s->count[0] - 1].last) {
+	timestamp = s->level[0][s->count[0] - 1].last;
+    }
+    b.first = b.last = timestamp;
+    b.min = b.max = value;
+    if (push(s, 0, &b)) {
+	return 1;
+    }
+    for (k = 0; k + 1 < TREND_LEVELS && s->count[k] % TREND_FANOUT == 0;
+	 k++) {
+	below = s->level[k] + s->count[k] - TREND_FANOUT;
+	b = below[0];
+	for (i = 1; i < TREND_FANOUT; i++) {
+	    b.min = below[i].min < b.min ? below[i].min : b.min;
+	    b.max = below[i].max > b.max ? below[i].max : b.max;
+	}
+	b.last = below[TREND_FANOUT - 1].last;
+	if (push(s, k + 1, &b)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/* first bucket in [lo, hi) that ends at or after t */
+static size_t ending_from(const struct trend_bucket * b, size_t lo, size_t hi,
+			  uint64_t t) {
+    size_t mid;
+
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (b[mid].last < t) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return lo;
+}
+
+/* first bucket in [lo, hi) that starts after t */
+static size_t starting_after(const struct trend_bucket * b, size_t lo,
+			     size_t hi, uint64_t t) {
+    size_t mid;
+
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (b[mid].first <= t) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return lo;
+}
+
+struct plot {
+    uint64_t t0, t1;
+    int columns;
+    double * min, * max;
+    size_t read;
+};
+
+static int column(const struct plot * p, uint64_t t) {
+    return (double) (t - p->t0) * p->columns / ((double) (p->t1 - p->t0) + 1);
+}
+
+/*
+ * draw bucket i of level k, or its children if it sticks out of the plot or
+ * falls in more than one column
+ */
+static void visit(const trend_series * s, struct plot * p, int k, size_t i) {
+    const struct trend_bucket * b = s->level[k] + i;
+    size_t j;
+    int c, c1;
+
+    p->read++;
+    if (b->last < p->t0 || b->first > p->t1) {
+	return;
+    }
+    if (b->first < p->t0 || b->last > p->t1) {
+	c = -1, c1 = -2;  /* only its children might be drawn */
+    } else {
+	c = column(p, b->first);
+	c1 = column(p, b->last);
+    }
+    if (c != c1 && k > 0) {
+	for (j = i * TREND_FANOUT; j < (i + 1) * TREND_FANOUT; j++) {
+	    visit(s, p, k - 1, j);
+	}
+    } else if (c >= 0) {
+	if (!(p->min[c] <= b->min)) {
+	    p->min[c] = b->min;
+	}
+	if (!(p->max[c] >= b->max)) {
+	    p->max[c] = b->max;
+	}
+    }
+}
+
+/*
+ * the lowest and highest value in each of columns equal slices of time
+ * [t0, t1], NaN where there are none. returns how many buckets were read.
+ */
+size_t trend_plot(const trend_series * s, uint64_t t0, uint64_t t1,
+		  int columns, double * min, double * max) {
+    struct plot p = {t0, t1, columns, min, max, 0};
+    size_t start, end;
+    int c, k, top;
+
+    for (c = 0; c < columns; c++) {
+	min[c] = max[c] = NAN;
+    }
+    if (t1 < t0 || columns <= 0) {
+	return 0;
+    }
+    for (top = TREND_LEVELS - 1; top > 0; top--) {
+	start = ending_from(s->level[top], 0, s->count[top], t0);
+	end = starting_after(s->level[top], start, s->count[top], t1);
+	if (end - start >= (size_t) columns) {
+	    break;
+	}
+    }
+    /* the top level, then what each level below has and the one above lacks */
+    for (k = top; k >= 0; k--) {
+	start = k == top ? 0 : s->count[k + 1] * TREND_FANOUT;
+	end = starting_after(s->level[k], start, s->count[k], t1);
+	start = ending_from(s->level[k], start, end, t0);
+	while (start < end) {
+	    visit(s, &p, k, start++);
+	}
+    }
+    return p.read;
+}
+
+void trend_free(trend_series * s) {
+    int k;
+
+    for (k = 0; k < TREND_LEVELS; k++) {
+	free(s->level[k]);
+	s->level[k] = NULL;
+	s->count[k] = s->size[k] = 0;
+    }
+}
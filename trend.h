@@ -0,0 +1,43 @@
+/*
+ * About : Readout values over time, kept for plotting at any zoom.
+ *
+ * Notes :
+ *
+ * A trend_series keeps every point added to it, in time order, and above
+ * them a pyramid of levels where each bucket holds the time span and the
+ * lowest and highest value of TREND_FANOUT buckets of the level below. A
+ * bucket is only made once all of them are there, so the newest points are
+ * covered by the lower levels alone.
+ *
+ * trend_plot() picks the coarsest level that still has a bucket per
+ * column, and only goes down a level for the buckets at either end of the
+ * range and those no level above covers yet. A plot thus reads about as
+ * many buckets as it has columns, however long the series has grown.
+ */
+
+#ifndef TREND_H
+#define TREND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TREND_FANOUT 8
+#define TREND_LEVELS 8  /* the top level keeps growing */
+
+struct trend_bucket {
+    uint64_t first, last;  /* timestamps, microseconds */
+    double min, max;
+};
+
+typedef struct {
+    size_t count[TREND_LEVELS];
+    size_t size[TREND_LEVELS];
+    struct trend_bucket * level[TREND_LEVELS];  /* level 0 are the points */
+} trend_series;
+
+int trend_add(trend_series * s, uint64_t timestamp, double value);
+size_t trend_plot(const trend_series * s, uint64_t t0, uint64_t t1,
+		  int columns, double * min, double * max);
+void trend_free(trend_series * s);
+
+#endif
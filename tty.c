@@ -0,0 +1,182 @@
+/*
+ * About : Frames drawn in a terminal, see tty.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "tty.h"
+
+#define TTY_CELL_MAX 52  /* cursor move, both colors and the block */
+#define TTY_BLOCK_COLORS 8  /* told apart in a block, more are rare */
+
+/*
+ * picture size for a terminal of cols x rows cells, the largest with the
+ * frame's shape that fits, and at most the frame's own. returns 0 on success.
+ */
+int tty_set(tty_view * t, int cols, int rows) {
+    int height = 2 * rows, i;
+
+    if (cols * FRAME_HEIGHT > height * FRAME_WIDTH) {
+	cols = height * FRAME_WIDTH / FRAME_HEIGHT;
+    } else {
+	height = cols * FRAME_HEIGHT / FRAME_WIDTH;
+    }
+    cols = cols > TTY_MAX_COLS ? TTY_MAX_COLS : cols;
+    rows = height / 2 > TTY_MAX_ROWS ? TTY_MAX_ROWS : height / 2;
+    if (cols < 1 || rows < 1) {
+	return 1;
+    }
+    if (!t->out) {
+	t->out = malloc(TTY_MAX_COLS * TTY_MAX_ROWS * TTY_CELL_MAX + 8);
+	if (!t->out) {
+	    return 1;
+	}
+    }
+    t->cols = cols;
+    t->rows = rows;
+    for (i = 0; i <= cols; i++) {
+	t->xsplit[i] = i * FRAME_WIDTH / cols;
+    }
+    for (i = 0; i <= 2 * rows; i++) {
+	t->ysplit[i] = i * FRAME_HEIGHT / (2 * rows);
+    }
+    t->valid = 0;
+    return 0;
+}
+
+/* the color of picture pixel (x, y), see tty.h */
+static uint8_t pixel(const tty_view * t, const uint8_t * indexed, int x,
+		     int y) {
+    uint8_t value[TTY_BLOCK_COLORS];
+    int count[TTY_BLOCK_COLORS];
+    int fx, fy, i, n = 0, most = 0, second = -1;
+    uint8_t v;
+
+    if (t->xsplit[x + 1] - t->xsplit[x] == 1
+	&& t->ysplit[y + 1] - t->ysplit[y] == 1) {
+	return indexed[t->ysplit[y] * FRAME_WIDTH + t->xsplit[x]];
+    }
+    for (fy = t->ysplit[y]; fy < t->ysplit[y + 1]; fy++) {
+	for (fx = t->xsplit[x]; fx < t->xsplit[x + 1]; fx++) {
+	    v = indexed[fy * FRAME_WIDTH + fx];
+	    for (i = 0; i < n && value[i] != v; i++) {
+	    }
+	    if (i < n) {
+		count[i]++;
+	    } else if (n < TTY_BLOCK_COLORS) {
+		value[n] = v;
+		count[n++] = 1;
+	    }
+	}
+    }
+    for (i = 1; i < n; i++) {
+	if (count[i] > count[most]) {
+	    most = i;
+	}
+    }
+    for (i = 0; i < n; i++) {
+	if (i != most && (second < 0 || count[i] > count[second])) {
+	    second = i;
+	}
+    }
+    return value[second < 0 ? most : second];
+}
+
+/* decimal, without the weight of printf */
+static char * put_number(char * p, int n) {
+    if (n >= 100) {
+	*p++ = '0' + n / 100;
+    }
+    if (n >= 10) {
+	*p++ = '0' + n / 10 % 10;
+    }
+    *p++ = '0' + n % 10;
+    return p;
+}
+
+static char * set_color(char * p, char layer, const uint8_t * rgb) {
+    *p++ = '\033';
+    *p++ = '[';
+    *p++ = layer;
+    *p++ = '8';
+    *p++ = ';';
+    *p++ = '2';
+    *p++ = ';';
+    p = put_number(p, rgb[0]);
+    *p++ = ';';
+    p = put_number(p, rgb[1]);
+    *p++ = ';';
+    p = put_number(p, rgb[2]);
+    *p++ = 'm';
+    return p;
+}
+
+static int rgb_value(const uint8_t * rgb) {
+    return rgb[0] << 16 | rgb[1] << 8 | rgb[2];
+}
+
+/*
+ * bring the terminal up to date with the frame: the escapes to write are
+ * left in t->out. returns their length, 0 if nothing changed.
+ */
+size_t tty_render(tty_view * t, const uint8_t * indexed,
+		  const uint8_t (*colors)[3]) {
+    const uint8_t * upper, * lower;
+    int row, col, cursor_row = -1, cursor_col = -1, fg = -1, bg = -1;
+    uint16_t cell;
+    char * p = t->out;
+
+    for (row = 0; row < t->rows; row++) {
+	for (col = 0; col < t->cols; col++) {
+	    cell = pixel(t, indexed, col, 2 * row) << 8
+		| pixel(t, indexed, col, 2 * row + 1);
+	    if (t->valid && t->prev[row * t->cols + col] == cell) {
+		continue;
+	    }
+	    t->prev[row * t->cols + col] = cell;
+	    if (row != cursor_row || col != cursor_col) {
+		*p++ = '\033';
+		*p++ = '[';
+		p = put_number(p, row + 1);
+		*p++ = ';';
+		p = put_number(p, col + 1);
+		*p++ = 'H';
+	    }
+	    upper = colors[cell >> 8];
+	    lower = colors[cell & 0xff];
+	    if (bg != rgb_value(lower)) {
+		p = set_color(p, '4', lower);
+		bg = rgb_value(lower);
+	    }
+	    if (rgb_value(upper) == bg) {
+		*p++ = ' ';
+	    } else {
+		if (fg != rgb_value(upper)) {
+		    p = set_color(p, '3', upper);
+		    fg = rgb_value(upper);
+		}
+		*p++ = '\xe2';  /* U+2580, upper half block */
+		*p++ = '\x96';
+		*p++ = '\x80';
+	    }
+	    cursor_row = row;
+	    cursor_col = col + 1;
+	}
+    }
+    if (p != t->out) {
+	memcpy(p, "\033[0m", 4);
+	p += 4;
+    }
+    *p = 0;
+    t->valid = 1;
+    return p - t->out;
+}
+
+void tty_invalidate(tty_view * t) {
+    t->valid = 0;
+}
+
+void tty_free(tty_view * t) {
+    free(t->out);
+    t->out = NULL;
+}
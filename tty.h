@@ -0,0 +1,45 @@
+/*
+ * About : Frames drawn in a terminal, with Unicode half blocks.
+ *
+ * Notes :
+ *
+ * Each character cell shows two pixels, one above the other: the upper
+ * half block in the foreground color over the background color, both set
+ * with 24 bit color escapes. Shrunk to fit the terminal, a pixel stands for
+ * a block of the frame and takes the block's second most common color when
+ * it has more than one, so one pixel wide traces and readout text survive
+ * on their flat backgrounds.
+ *
+ * tty_render() keeps the color pair of every cell it last wrote and only
+ * writes cells that differ, moving the cursor over the rest, so what goes
+ * down the wire follows how much of the screen changed, not its size. The
+ * terminal must be left alone between calls, or tty_invalidate() called, as
+ * after switching the palette or a resize.
+ */
+
+#ifndef TTY_H
+#define TTY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "decode.h"
+
+#define TTY_MAX_COLS FRAME_WIDTH
+#define TTY_MAX_ROWS (FRAME_HEIGHT / 2)
+
+typedef struct {
+    int cols, rows;  /* cells of the picture, from the top left corner */
+    int xsplit[TTY_MAX_COLS + 1];  /* first frame column of each pixel */
+    int ysplit[2 * TTY_MAX_ROWS + 1];
+    int valid;  /* prev is on the terminal */
+    uint16_t prev[TTY_MAX_COLS * TTY_MAX_ROWS];  /* upper << 8 | lower */
+    char * out;  /* escapes written by the last tty_render() */
+} tty_view;
+
+int tty_set(tty_view * t, int cols, int rows);
+size_t tty_render(tty_view * t, const uint8_t * indexed,
+		  const uint8_t (*colors)[3]);
+void tty_invalidate(tty_view * t);
+void tty_free(tty_view * t);
+
+#endif
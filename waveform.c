@@ -0,0 +1,93 @@
+/*
+ * About : Channel traces read back off the screen, see waveform.h.
+ */
+
+#include "decode.h"
+#include "waveform.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Channel-1 and Channel-2 trace colors, see palette.c */
+const uint8_t wave_colors[WAVE_CHANNELS] = {2, 4};
+
+/*
+ * fill samples[WAVE_W] with the trace drawn in color. returns how many
+ * columns it was seen in, 0 if the channel is off.
+ */
+int waveform_extract(const uint8_t * indexed, int color, float * samples) {
+    const uint8_t * row;
+    int16_t top[WAVE_W], bottom[WAVE_W], t, b;
+    int x, y, seen = 0, last = -1, i;
+
+    /* row by row, the way the frame lies in memory */
+    for (x = 0; x < WAVE_W; x++) {
+	top[x] = WAVE_H;
+	bottom[x] = -1;
+    }
+    for (y = 0; y < WAVE_H; y++) {
+	row = indexed + (WAVE_Y + y) * FRAME_WIDTH + WAVE_X;
+	x = 0;
+#ifdef __SSE2__
+	{
+	    const __m128i want = _mm_set1_epi8(color);
+	    const __m128i here = _mm_set1_epi16(y), none = _mm_set1_epi16(-1);
+	    const __m128i below = _mm_set1_epi16(WAVE_H);
+	    __m128i hit, lo, hi, * tp, * bp;
+
+	    /* 16 columns at a time, as two halves of 8 16 bit lanes */
+	    for (; x + 16 <= WAVE_W; x += 16) {
+		hit = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)
+						     (row + x)), want);
+		lo = _mm_unpacklo_epi8(hit, hit);
+		hi = _mm_unpackhi_epi8(hit, hit);
+		tp = (__m128i *) (top + x);
+		bp = (__m128i *) (bottom + x);
+		_mm_storeu_si128(tp, _mm_min_epi16(_mm_loadu_si128(tp),
+		    _mm_or_si128(_mm_and_si128(lo, here),
+				 _mm_andnot_si128(lo, below))));
+		_mm_storeu_si128(tp + 1, _mm_min_epi16(_mm_loadu_si128(tp + 1),
+		    _mm_or_si128(_mm_and_si128(hi, here),
+				 _mm_andnot_si128(hi, below))));
+		_mm_storeu_si128(bp, _mm_max_epi16(_mm_loadu_si128(bp),
+		    _mm_or_si128(_mm_and_si128(lo, here),
+				 _mm_andnot_si128(lo, none))));
+		_mm_storeu_si128(bp + 1, _mm_max_epi16(_mm_loadu_si128(bp + 1),
+		    _mm_or_si128(_mm_and_si128(hi, here),
+				 _mm_andnot_si128(hi, none))));
+	    }
+	}
+#endif
+	for (; x < WAVE_W; x++) {
+	    t = row[x] == color ? y : WAVE_H;
+	    b = row[x] == color ? y : -1;
+	    top[x] = t < top[x] ? t : top[x];
+	    bottom[x] = b > bottom[x] ? b : bottom[x];
+	}
+    }
+
+    for (x = 0; x < WAVE_W; x++) {
+	if (bottom[x] < 0) {
+	    continue;
+	}
+	samples[x] = WAVE_H / 2.0f - (top[x] + bottom[x]) / 2.0f;
+	if (last < 0) {
+	    /* nothing to the left, hold the first value */
+	    for (i = 0; i < x; i++) {
+		samples[i] = samples[x];
+	    }
+	} else {
+	    for (i = last + 1; i < x; i++) {
+		samples[i] = samples[last] + (samples[x] - samples[last])
+		    * (i - last) / (x - last);
+	    }
+	}
+	last = x;
+	seen++;
+    }
+    for (i = last + 1; last >= 0 && i < WAVE_W; i++) {
+	samples[i] = samples[last];
+    }
+    return seen;
+}
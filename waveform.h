@@ -0,0 +1,31 @@
+/*
+ * About : Channel traces read back off the screen, one sample per column.
+ *
+ * Notes :
+ *
+ * Inside the graticule each channel's trace is drawn in its own color, so a
+ * column's sample is the middle of the pixels of that color in it, in
+ * pixels above the graticule's center line. Columns the trace misses (a
+ * steep edge drawn as dots, a cursor on top) are filled in along a straight
+ * line from their neighbours.
+ *
+ * Like the readout boxes, the graticule position is taken from a GDS-820C
+ * screen dump and may be off by a few pixels on other firmware.
+ */
+
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <stdint.h>
+
+#define WAVE_X 0  /* graticule, in frame pixels */
+#define WAVE_Y 12
+#define WAVE_W 250
+#define WAVE_H 200
+
+#define WAVE_CHANNELS 2
+extern const uint8_t wave_colors[WAVE_CHANNELS];  /* color index of each */
+
+int waveform_extract(const uint8_t * indexed, int color, float * samples);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * About : A magnified view of part of a frame, see zoom.h.
+ */
+
+#include <string.h>
+#include "zoom.h"
+
+/*
+ * show region (x, y, w, h) of the frame on a dst_w x dst_h picture, which
+ * will be drawn in full next time. returns 0 on success.
+ */
+int zoom_set(zoom_view * z, int x, int y, int w, int h, int dst_w, int dst_h) {
+    int i, k;
+
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > FRAME_WIDTH
+	|| y + h > FRAME_HEIGHT) {
+	return 1;
+    }
+    zoom_free(z);
+    if (scale_init(&z->map, w, h, dst_w, dst_h)) {
+	return 1;
+    }
+    z->x = x;
+    z->y = y;
+    z->w = w;
+    z->h = h;
+    z->dst_w = dst_w;
+    z->dst_h = dst_h;
+    for (i = 0; i < dst_w; i++) {
+	z->map.xmap[i] += x;
+    }
+    for (i = 0; i < dst_h; i++) {
+	z->map.ymap[i] += y;
+    }
+    /* the maps only go up, so each tile's columns and rows are a run */
+    for (k = 0, i = 0; k <= ZOOM_TILES_X; k++) {
+	while (i < dst_w && z->map.xmap[i] < k * ZOOM_TILE) {
+	    i++;
+	}
+	z->xsplit[k] = i;
+    }
+    for (k = 0, i = 0; k <= ZOOM_TILES_Y; k++) {
+	while (i < dst_h && z->map.ymap[i] < k * ZOOM_TILE) {
+	    i++;
+	}
+	z->ysplit[k] = i;
+    }
+    z->valid = 0;
+    return 0;
+}
+
+static int tile_changed(const zoom_view * z, const uint8_t * indexed,
+			int tx, int ty) {
+    int y, offset;
+
+    for (y = ty * ZOOM_TILE; y < (ty + 1) * ZOOM_TILE; y++) {
+	offset = y * FRAME_WIDTH + tx * ZOOM_TILE;
+	if (memcmp(indexed + offset, z->prev + offset, ZOOM_TILE)) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+static void tile_draw(zoom_view * z, const uint8_t * indexed,
+		      const uint8_t (*colors)[3], uint8_t * rgb, int stride,
+		      int tx, int ty) {
+    const uint8_t * row;
+    uint8_t * out;
+    int x, y, offset;
+
+    for (y = z->ysplit[ty]; y < z->ysplit[ty + 1]; y++) {
+	out = rgb + (long) y * stride;
+	if (y > z->ysplit[ty] && z->map.ymap[y] == z->map.ymap[y - 1]) {
+	    /* magnified, the same as the row above */
+	    memcpy(out + 3 * z->xsplit[tx], out - stride + 3 * z->xsplit[tx],
+		   3 * (z->xsplit[tx + 1] - z->xsplit[tx]));
+	    continue;
+	}
+	row = indexed + z->map.ymap[y] * FRAME_WIDTH;
+	for (x = z->xsplit[tx]; x < z->xsplit[tx + 1]; x++) {
+	    memcpy(out + 3 * x, colors[row[z->map.xmap[x]]], 3);
+	}
+    }
+    for (y = ty * ZOOM_TILE; y < (ty + 1) * ZOOM_TILE; y++) {
+	offset = y * FRAME_WIDTH + tx * ZOOM_TILE;
+	memcpy(z->prev + offset, indexed + offset, ZOOM_TILE);
+    }
+}
+
+/*
+ * bring the picture (rows stride bytes apart) up to date with the frame.
+ * returns how many tiles were redrawn.
+ */
+int zoom_render(zoom_view * z, const uint8_t * indexed,
+		const uint8_t (*colors)[3], uint8_t * rgb, int stride) {
+    int tx, ty, drawn = 0;
+
+    for (ty = z->y / ZOOM_TILE; ty <= (z->y + z->h - 1) / ZOOM_TILE; ty++) {
+	if (z->ysplit[ty] == z->ysplit[ty + 1]) {
+	    continue; /* shrunk away */
+	}
+	for (tx = z->x / ZOOM_TILE; tx <= (z->x + z->w - 1) / ZOOM_TILE;
+	     tx++) {
+	    if (z->xsplit[tx] == z->xsplit[tx + 1]
+		|| (z->valid && !tile_changed(z, indexed, tx, ty))) {
+		continue;
+	    }
+	    tile_draw(z, indexed, colors, rgb, stride, tx, ty);
+	    drawn++;
+	}
+    }
+    z->valid = 1;
+    return drawn;
+}
+
+void zoom_invalidate(zoom_view * z) {
+    z->valid = 0;
+}
+
+void zoom_free(zoom_view * z) {
+    scale_free(&z->map);
+}
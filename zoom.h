@@ -0,0 +1,48 @@
+/*
+ * About : A magnified view of part of a frame, redrawn a tile at a time.
+ *
+ * Notes :
+ *
+ * The view shows the region (x, y, w, h) of an indexed frame stretched,
+ * nearest neighbour, to a dst_w x dst_h RGB picture. The frame is cut into
+ * ZOOM_TILE pixel squares, and zoom_render() only redraws the part of the
+ * picture under squares that changed since the last call, straight from
+ * color indices to RGB through a table: a palette_lut's rgb, or any other
+ * with an entry for every index the frame holds (see overlay.h). Only the
+ * visible region is ever looked at, so a close up costs less than the whole
+ * frame at 1x, and an unchanged screen costs a compare.
+ *
+ * The RGB picture is the caller's and must be left alone between calls, or
+ * zoom_invalidate() called, as after switching the palette.
+ */
+
+#ifndef ZOOM_H
+#define ZOOM_H
+
+#include <stdint.h>
+#include "decode.h"
+#include "palette.h"
+#include "scale.h"
+
+#define ZOOM_TILE 16
+#define ZOOM_TILES_X (FRAME_WIDTH / ZOOM_TILE)
+#define ZOOM_TILES_Y (FRAME_HEIGHT / ZOOM_TILE)
+#define ZOOM_MAX 16
+
+typedef struct {
+    int x, y, w, h;  /* visible region of the frame */
+    int dst_w, dst_h;
+    scale_map map;  /* frame coordinates for every picture row and column */
+    int xsplit[ZOOM_TILES_X + 1];  /* first picture column of each tile */
+    int ysplit[ZOOM_TILES_Y + 1];
+    int valid;  /* prev is on the picture */
+    uint8_t prev[FRAME_PIXELS];
+} zoom_view;
+
+int zoom_set(zoom_view * z, int x, int y, int w, int h, int dst_w, int dst_h);
+int zoom_render(zoom_view * z, const uint8_t * indexed,
+		const uint8_t (*colors)[3], uint8_t * rgb, int stride);
+void zoom_invalidate(zoom_view * z);
+void zoom_free(zoom_view * z);
+
+#endif